@@ -6,19 +6,21 @@ src="${1:-src/main.c}"
     # -g -fsanitize=address \
 
 gcc $(pkg-config --cflags sqlite3) \
-    $(pkg-config --cflags ncurses) \
+    $(pkg-config --cflags ncursesw) \
     $(pkg-config --cflags libcyaml) \
     -g -fsanitize=address \
+    -pthread \
     -obin "$src" \
-    $(pkg-config --libs ncurses) \
+    $(pkg-config --libs ncursesw) \
     $(pkg-config --libs sqlite3) \
     $(pkg-config --libs libcyaml) \
 
 #gcc $(pkg-config --cflags sqlite3) \
-#    $(pkg-config --cflags ncurses) \
+#    $(pkg-config --cflags ncursesw) \
 #    $(pkg-config --cflags libcyaml) \
 #    -g \
+#    -pthread \
 #    -obin "$src" \
-#    $(pkg-config --libs ncurses) \
+#    $(pkg-config --libs ncursesw) \
 #    $(pkg-config --libs sqlite3) \
 #    $(pkg-config --libs libcyaml) \
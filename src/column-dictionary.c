@@ -0,0 +1,222 @@
+/* Column Dictionary
+ * =================
+ *
+ *  Stores each distinct text value of a column once.  Columns such as a
+ *  status, a type or a country code repeat the same few values in every
+ *  row, so rather than copying the text of every cell to the column's
+ *  str_data, a value is copied the first time it is seen, and every cell
+ *  that holds it points to that copy.  Its display width is measured once
+ *  too.
+ *
+ *  Every cell still has its Table_Cell, so only the text is saved.  For
+ *  short values, such as a status, that is small next to the cells.  The
+ *  cells are not replaced with an array of codes, as the main thread reads
+ *  the cells of a loading table through pointers into their vector (see
+ *  table-loader.c), and a column is only known to repeat its values after
+ *  the first of its rows have been shown.
+ *
+ *  Each value is given a code, counting from 1, which is kept in the cell's
+ *  dict_code.  Two cells of the same column hold the same text exactly when
+ *  they have the same code, so comparing them needs no string compare.  A
+ *  cell whose code is 0 was stored without the dictionary.
+ *
+ *  A column whose values rarely repeat gains nothing from a dictionary.
+ *  Once COLUMN_DICTIONARY_TRIAL_SIZE text cells have been added, the
+ *  dictionary is disabled as soon as a new value would leave fewer than
+ *  COLUMN_DICTIONARY_MIN_REPEATS cells for each value, or when it holds
+ *  COLUMN_DICTIONARY_MAX_ENTRIES values.  Its memory is then freed, and the
+ *  rest of the column's text is copied for each cell.  Cells that already
+ *  have codes keep them, as no code is ever given to another value.
+ *
+ *  Entries are found through an open-addressed hash table, as in
+ *  column-index.c.  A dictionary belongs to the thread loading its column.
+ *  A parallel scan gives each segment dictionaries of its own, which are
+ *  merged into the table's as the segments are stitched together.
+ *  Clearing the rows of a table clears the dictionaries of its columns.
+ */
+
+#define COLUMN_DICTIONARY_TRIAL_SIZE 1024
+#define COLUMN_DICTIONARY_MIN_REPEATS 4
+#define COLUMN_DICTIONARY_MAX_ENTRIES UINT16_MAX  // Codes fit in dict_code.
+#define COLUMN_DICTIONARY_MIN_SLOT_COUNT 64
+
+void clear_column_dictionary(Column_Dictionary *dict)
+{
+    free(dict->entry_arr);
+    free(dict->slot_arr);
+    *dict = (Column_Dictionary){ 0 };
+}
+
+// Stop adding values to the dictionary until it is cleared.
+void disable_column_dictionary(Column_Dictionary *dict)
+{
+    free(dict->entry_arr);
+    free(dict->slot_arr);
+    dict->entry_arr = NULL;
+    dict->entry_capacity = 0;
+    dict->slot_arr = NULL;
+    dict->slot_count = 0;
+    dict->is_disabled = 1;
+}
+
+Dictionary_Entry *entry_from_column_dictionary(Column_Dictionary *dict, uint32_t code)
+{
+    assert(code > 0 && code <= (uint32_t)dict->entry_count);
+    return &dict->entry_arr[code - 1];
+}
+
+void insert_entry_into_column_dictionary(Column_Dictionary *dict, int entry_idx)
+{
+    int mask = dict->slot_count - 1;
+    int slot = dict->entry_arr[entry_idx].hash & mask;
+    while (-1 != dict->slot_arr[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    dict->slot_arr[slot] = entry_idx;
+}
+
+void resize_column_dictionary(Column_Dictionary *dict, int slot_count)
+{
+    free(dict->slot_arr);
+    dict->slot_arr = (int *)malloc(slot_count * sizeof(int));
+    memset(dict->slot_arr, -1, slot_count * sizeof(int));
+    dict->slot_count = slot_count;
+
+    loop (entry_idx, dict->entry_count) {
+        insert_entry_into_column_dictionary(dict, entry_idx);
+    }
+}
+
+// Returns the code of the entry holding text, or 0 if there is none.
+uint32_t code_from_column_dictionary(Column_Dictionary *dict, const char *text, uint32_t size, uint32_t hash)
+{
+    if (!dict->slot_count) {
+        return 0;
+    }
+    int mask = dict->slot_count - 1;
+    int slot = hash & mask;
+    while (-1 != dict->slot_arr[slot]) {
+        Dictionary_Entry *entry = &dict->entry_arr[dict->slot_arr[slot]];
+        if (hash == entry->hash && size == entry->str_size && 0 == memcmp(text, entry->str, size)) {
+            return dict->slot_arr[slot] + 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return 0;
+}
+
+int column_dictionary_has_room(Column_Dictionary *dict)
+{
+    if (dict->entry_count >= COLUMN_DICTIONARY_MAX_ENTRIES) {
+        return 0;
+    }
+    return dict->value_count < COLUMN_DICTIONARY_TRIAL_SIZE
+        || (dict->entry_count + 1) * COLUMN_DICTIONARY_MIN_REPEATS <= dict->value_count;
+}
+
+// Returns the code of the new entry.
+uint32_t add_entry_to_column_dictionary(Column_Dictionary *dict, Dictionary_Entry *entry)
+{
+    if (dict->entry_count == dict->entry_capacity) {
+        dict->entry_capacity = dict->entry_capacity? 2 * dict->entry_capacity : 64;
+        dict->entry_arr = (Dictionary_Entry *)realloc(
+                dict->entry_arr, dict->entry_capacity * sizeof(Dictionary_Entry));
+    }
+    dict->entry_arr[dict->entry_count++] = *entry;
+
+    if (2 * dict->entry_count > dict->slot_count) {
+        int slot_count = COLUMN_DICTIONARY_MIN_SLOT_COUNT;
+        while (slot_count < 2 * dict->entry_count) {
+            slot_count *= 2;
+        }
+        resize_column_dictionary(dict, slot_count);
+    } else {
+        insert_entry_into_column_dictionary(dict, dict->entry_count - 1);
+    }
+    return dict->entry_count;
+}
+
+// Point a text cell, whose str_size is set, at the column's copy of text,
+// copying text to the column's str_data if it has not been seen before.
+// Returns 0, leaving the cell as it was, if the column no longer uses a
+// dictionary, when the text must be copied for the cell alone.
+int intern_table_cell_text(Table_Column *column, Table_Cell *cell, const char *text)
+{
+    Column_Dictionary *dict = &column->dictionary;
+    if (dict->is_disabled) {
+        return 0;
+    }
+    ++dict->value_count;
+
+    uint32_t hash = hash_bytes(text, cell->str_size);
+    uint32_t code = code_from_column_dictionary(dict, text, cell->str_size, hash);
+    if (!code) {
+        if (!column_dictionary_has_room(dict)) {
+            disable_column_dictionary(dict);
+            return 0;
+        }
+        cell->str_data = (char *)dymem_allocate(column->dymem_str_data, cell->str_size + 1);
+        memcpy(cell->str_data, text, cell->str_size + 1);
+        measure_table_cell(column, cell);
+
+        Dictionary_Entry entry = {
+            .str = cell->str_data,
+            .str_size = cell->str_size,
+            .hash = hash,
+            .display_width = cell->display_width,
+            .fit_size = cell->fit_size,
+        };
+        cell->dict_code = add_entry_to_column_dictionary(dict, &entry);
+        return 1;
+    }
+
+    Dictionary_Entry *entry = entry_from_column_dictionary(dict, code);
+    cell->str_data = (char *)entry->str;
+    cell->display_width = entry->display_width;
+    cell->fit_size = entry->fit_size;
+    cell->dict_code = code;
+    return 1;
+}
+
+// Merge the dictionary of a parallel scan segment's column into the
+// table's column, whose cells from first_row on, and str_data, were
+// appended from the segment's.  The segment's cells are given the codes of
+// the table's dictionary.
+void merge_column_dictionary(Table_Column *column, Table_Column *segment_column, int first_row)
+{
+    Column_Dictionary *dict = &column->dictionary;
+    Column_Dictionary *segment_dict = &segment_column->dictionary;
+    uint16_t *code_map = NULL;
+
+    dict->value_count += segment_dict->value_count;
+    if (segment_dict->is_disabled) {
+        disable_column_dictionary(dict);
+    }
+    if (!segment_dict->entry_count) {
+        // No cell of the segment has a code.
+        return;
+    }
+    if (!dict->is_disabled) {
+        code_map = (uint16_t *)malloc(segment_dict->entry_count * sizeof(uint16_t));
+        loop (entry_idx, segment_dict->entry_count) {
+            Dictionary_Entry *entry = &segment_dict->entry_arr[entry_idx];
+            uint32_t code = code_from_column_dictionary(dict, entry->str, entry->str_size, entry->hash);
+            if (!code) {
+                if (!column_dictionary_has_room(dict)) {
+                    disable_column_dictionary(dict);
+                    break;
+                }
+                code = add_entry_to_column_dictionary(dict, entry);
+            }
+            code_map[entry_idx] = code;
+        }
+    }
+
+    loop_from (row_idx, first_row, first_row + segment_column->cell_count) {
+        Table_Cell *cell = (Table_Cell *)vec_seek(column->cell_vec, row_idx);
+        if (cell->dict_code) {
+            cell->dict_code = dict->is_disabled? 0 : code_map[cell->dict_code - 1];
+        }
+    }
+    free(code_map);
+}
@@ -0,0 +1,148 @@
+/* Column Index
+ * ============
+ *
+ *  A hash index from the values of a column to the rows that hold them, used
+ *  to find the row a foreign key refers to without scanning the column.
+ *
+ *  An index is built the first time a column is searched, and is extended
+ *  with any rows loaded since on each later search, so a table that is still
+ *  loading in the background can be searched as it grows.  Clearing the rows
+ *  of a table, as when its window slides, drops the indexes of its columns.
+ *
+ *  The index is open-addressed with linear probing.  Each slot holds a row
+ *  number, or -1 if it is empty.  The slot count is kept at least twice the
+ *  row count, so that probes stay short.  Rows with the same value are kept
+ *  in the order they were added, so a search finds the first of them.
+ *
+ *  NULLs, BLOBs and partial values are not indexed, and never match.  An integer matches
+ *  text that reads as the same integer, as SQLite's comparison would after
+ *  applying the column's affinity.
+ */
+
+#define COLUMN_INDEX_MIN_SLOT_COUNT 64
+
+int is_cell_indexable(Table_Cell *cell)
+{
+    return DYTYPE_NULL != cell->type && DYTYPE_BLOB != cell->type && !cell->is_partial;
+}
+
+// Text that reads as an integer is hashed as that integer, so that it
+// matches the same value stored as an integer.
+uint32_t hash_table_cell(Table_Column *column, Table_Cell *cell)
+{
+    if (DYTYPE_INT == cell->type) {
+        return hash_int64(cell->data_as_int);
+    }
+    const char *str = str_from_table_cell(column, cell);
+    int64_t value = 0;
+    if (DYTYPE_TEXT == cell->type && parse_int64(str, &value)) {
+        return hash_int64(value);
+    }
+    return hash_str(str);
+}
+
+int table_cells_are_equal(Table_Column *column1, Table_Cell *cell1, Table_Column *column2, Table_Cell *cell2)
+{
+    if (column1 == column2 && cell1->dict_code && cell2->dict_code) {
+        return cell1->dict_code == cell2->dict_code;
+    }
+    if (DYTYPE_INT == cell1->type && DYTYPE_INT == cell2->type) {
+        return cell1->data_as_int == cell2->data_as_int;
+    }
+    return 0 == strcmp(str_from_table_cell(column1, cell1), str_from_table_cell(column2, cell2));
+}
+
+void insert_row_into_column_index(Table_Column *column, int row_idx)
+{
+    Column_Index *index = column->index;
+    Table_Cell *cell = (Table_Cell *)vec_seek(column->cell_vec, row_idx);
+    if (!is_cell_indexable(cell)) {
+        return;
+    }
+
+    int mask = index->slot_count - 1;
+    int slot = hash_table_cell(column, cell) & mask;
+    while (-1 != index->slot_arr[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    index->slot_arr[slot] = row_idx;
+}
+
+void resize_column_index(Table_Column *column, int slot_count)
+{
+    Column_Index *index = column->index;
+
+    free(index->slot_arr);
+    index->slot_arr = (int *)malloc(slot_count * sizeof(int));
+    memset(index->slot_arr, -1, slot_count * sizeof(int));
+    index->slot_count = slot_count;
+
+    loop (row_idx, index->row_count) {
+        insert_row_into_column_index(column, row_idx);
+    }
+}
+
+// Index any rows loaded since the index was last used.
+void update_column_index(Table *table, Table_Column *column)
+{
+    int row_count = loaded_row_count(table);
+    Column_Index *index = column->index;
+
+    if (NULL == index) {
+        index = (Column_Index *)malloc(sizeof(Column_Index));
+        index->slot_count = 0;
+        index->row_count = 0;
+        index->slot_arr = NULL;
+        column->index = index;
+    }
+    if (row_count == index->row_count) {
+        return;
+    }
+
+    if (2 * row_count > index->slot_count) {
+        int slot_count = COLUMN_INDEX_MIN_SLOT_COUNT;
+        while (slot_count < 2 * row_count) {
+            slot_count *= 2;
+        }
+        resize_column_index(column, slot_count);
+    }
+    loop_from (row_idx, index->row_count, row_count) {
+        insert_row_into_column_index(column, row_idx);
+    }
+    index->row_count = row_count;
+}
+
+// Returns the first loaded row of table whose cell in column equals the
+// given cell of key_column, or -1 if there is none.
+int row_from_column_index(Table *table, Table_Column *column, Table_Column *key_column, Table_Cell *key_cell)
+{
+    if (!is_cell_indexable(key_cell)) {
+        return -1;
+    }
+    update_column_index(table, column);
+
+    Column_Index *index = column->index;
+    if (!index->slot_count) {
+        return -1;
+    }
+    int mask = index->slot_count - 1;
+    int slot = hash_table_cell(key_column, key_cell) & mask;
+    while (-1 != index->slot_arr[slot]) {
+        int row_idx = index->slot_arr[slot];
+        Table_Cell *cell = (Table_Cell *)vec_seek(column->cell_vec, row_idx);
+        if (table_cells_are_equal(column, cell, key_column, key_cell)) {
+            return row_idx;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+void free_column_index(Table_Column *column)
+{
+    if (NULL != column->index) {
+        free(column->index->slot_arr);
+        free(column->index);
+        column->index = NULL;
+    }
+}
@@ -17,19 +17,72 @@
  *  accessed via the Table struct members.  The memory pool can store multiple
  *  such collections.
  *
- *  Data queried from the SQL database is copied to Table_Memory.  Text data are
- *  copied straight to str_data.  Binary data are stored in raw_data, but a
- *  string representation is also kept in str_data.  Only the contents of
- *  str_data will be displayed to the user.
+ *  When a table is no longer needed, release_table_from_table_pool gives its
+ *  pages back to the pool's Page_Pool, where they are reused by the next
+ *  table that is loaded.  The table's slot in the pool is reused too.
+ *
+ *  Loaded tables are cached in the pool, keyed by the name or SQL they were
+ *  loaded from, so that opening a table again reuses the copy in memory.
+ *  Tables are reference counted: each view of a table, and each column whose
+ *  foreign key refers to it, holds a reference.  A table that is no longer
+ *  referenced stays in the pool until more than TABLE_POOL_MAX_IDLE_TABLES
+ *  tables are idle, when the least recently used are released.
+ *
+ *  A pool may also be given a memory budget, max_bytes.  While the tables in
+ *  the pool hold more than that, the least recently viewed idle tables are
+ *  released too.  Tables that are referenced are never released, so a pool
+ *  can stay over its budget; see enforce_memory_budget for what the app does
+ *  then.  A released table is loaded again when it is next opened.
+ *
+ *  If the pool's Page_Pool spills to disk, the cells and data of each column
+ *  can be paged out to the spill file as they load, and are read back in
+ *  when the view next touches them.  Only the thread loading a table may
+ *  page it out, as the pages it is writing to must not be dropped under it.
+ *
+ *  A cached table is only reused if the database has not changed since it
+ *  was loaded.  See Db_Version.
+ *
+ *  Data queried from the SQL database is copied to the memory of the column it
+ *  belongs to.  Text data are copied to str_data, each distinct value of a
+ *  column only once while its values repeat; see column-dictionary.c.
+ *  Binary data are stored in raw_data, and str_data points to a label
+ *  shared by every BLOB, as it does for every NULL.
+ *  Integers and floats are stored in the cell itself.  Their str_data is only
+ *  formatted when it is first needed, by str_from_table_cell, so that numbers
+ *  that are never displayed never take up string memory.  The formatted text
+ *  is kept in the column's view_data, which belongs to the main thread.  Only the contents of
+ *  str_data will be displayed to the user, and must be read through
+ *  str_from_table_cell.
  *
  *  Refernces to these data are found in Table_Cell objects.  These are stored
  *  in an array representing their columns.
  *
- *  While the Table_Cell objects are stored contiguously by column, their data
- *  are stored by row.  This is because there is only one memory buffer and
- *  data fetched from the database is written row by row.  It may improve
- *  performance to group the data by column as well.  This would require a pool
- *  of buffers, one per column.
+ *  Both the Table_Cell objects and their data are stored contiguously by
+ *  column.  Each column has its own buffers for string and binary data, so
+ *  reading down a column reads memory in order, rather than skipping over the
+ *  data of every other column in the row.  The column buffers start small and
+ *  grow with the column.  Table_Memory holds the data that belong to the table
+ *  as a whole, such as the column names.
+ *
+ *  Large tables are loaded through a window.  Only TABLE_WINDOW_SIZE rows
+ *  around the cursor are kept in memory.  When the cursor comes within
+ *  TABLE_WINDOW_MARGIN rows of either edge of the window, the window is
+ *  reloaded so that the cursor is at its centre.  Rows are fetched by rowid
+ *  (keyset pagination), so loading a window costs the same wherever it is in
+ *  the table.  Tables without a rowid, and views, are loaded in full.
+ *
+ *  If the app is started with more than one scan worker, tables with a rowid
+ *  are instead loaded in full by a parallel scan.  See table-loader.c.
+ *
+ *  Either way, a value of a table with a rowid that is longer than
+ *  CELL_MAX_COPY_SIZE is not copied.  The rows are selected with a preview
+ *  of each value, long enough to fill the widest column, and its length (see
+ *  new_preview_select_sql), so SQLite never hands over a large value in
+ *  full, and a large BLOB is not read at all.  The cell of a longer value is
+ *  marked partial, and keeps the rowid of its row, and for text the
+ *  preview.  The whole value is read from the database only when it is
+ *  viewed; see value-reader.c.  Partial values are never matched by a column
+ *  index.
  *
  *  The cell value type will be stored in Table_Cell in case we wish to work
  *  with the original types.
@@ -40,14 +93,34 @@
  *     64-bit signed integer 64-bit IEEE floating point number string BLOB NULL
  */
 
+void release_table_from_table_pool(Table_Pool *pool, Table *table);
+void unref_table_from_table_pool(Table_Pool *pool, Table *table);
+void free_column_data(Table_Column *column);
+
+// Defined in column-index.c
+void free_column_index(Table_Column *column);
+int is_cell_indexable(Table_Cell *cell);
+
+// Defined in column-dictionary.c
+void clear_column_dictionary(Column_Dictionary *dict);
+int intern_table_cell_text(Table_Column *column, Table_Cell *cell, const char *text);
+
+// Defined in table-loader.c
+int loaded_row_count(Table *table);
+int poll_table_loader(Table *table);
+void cancel_table_loader(Table *table);
+int start_table_loader_using_sqlite(Table *table, sqlite3 *db, sqlite3_stmt *stmt, int row_limit);
+int start_table_scan_using_sqlite(Table *table, sqlite3 *db, int worker_count);
+
 int dytype_from_sqlite_str(const char *sqlite_type)
 {
     if (NULL == sqlite_type) return DYTYPE_UNKNOWN;
-    if (0 == strcmp("NULL", sqlite_type)) return DYTYPE_NULL;
-    if (0 == strcmp("INTEGER", sqlite_type)) return DYTYPE_INT;
-    if (0 == strcmp("FLOAT", sqlite_type)) return DYTYPE_FLOAT;
-    if (0 == strcmp("BLOB", sqlite_type)) return DYTYPE_BLOB;
-    if (0 == strcmp("TEXT", sqlite_type)) return DYTYPE_TEXT;
+    // Declared types are not case sensitive.
+    if (0 == sqlite3_stricmp("NULL", sqlite_type)) return DYTYPE_NULL;
+    if (0 == sqlite3_stricmp("INTEGER", sqlite_type)) return DYTYPE_INT;
+    if (0 == sqlite3_stricmp("FLOAT", sqlite_type)) return DYTYPE_FLOAT;
+    if (0 == sqlite3_stricmp("BLOB", sqlite_type)) return DYTYPE_BLOB;
+    if (0 == sqlite3_stricmp("TEXT", sqlite_type)) return DYTYPE_TEXT;
     return DYTYPE_UNKNOWN;
 }
 
@@ -75,10 +148,46 @@ char *sqlite3_type_as_str(int type)
     }
 }
 
+#define TABLE_POOL_MAX_FREE_BYTES MB(32)
+#define TABLE_POOL_MAX_IDLE_TABLES 8
+#define COLUMN_INIT_PAGE_SIZE KB(16)
+#define COLUMN_MAX_PAGE_SIZE MB(2)
+#define TABLE_WINDOW_SIZE 2000
+#define TABLE_WINDOW_MARGIN 200
+#define COLUMN_MAX_WIDTH 40
+#define CELL_MAX_COPY_SIZE 1024  // Bytes of a BLOB, or characters of text.
+#define CELL_PREVIEW_SIZE (4 * COLUMN_MAX_WIDTH)  // Bytes of a partial text.
+
+// Floats are formatted when they are displayed, so their width is not known
+// while they load.  "%.15g" gives at most a sign, 15 digits, a point and an
+// exponent of up to 5 characters, as in -1.23456789012345e-300.
+#define FLOAT_DISPLAY_WIDTH 22
+
 void init_table_pool(Table_Pool *pool)
 {
     pool->table_count = 0;
+    pool->use_count = 0;
+    pool->max_bytes = 0;
+    pool->is_paging_out = 0;
+    pool->is_over_budget = 0;
     pool->table_vec = new_vector(sizeof(Table), 3);
+    init_page_pool(&pool->page_pool, TABLE_POOL_MAX_FREE_BYTES);
+}
+
+void free_table_pool(Table_Pool *pool)
+{
+    Vector_Iter *iter = new_vector_iter(pool->table_vec);
+    Table *table = NULL;
+
+    vec_loop (iter, Table, table) {
+        if (NULL != table->data_mem) {
+            release_table_from_table_pool(pool, table);
+        }
+    } delete_vector_iter(iter);
+
+    delete_vector(pool->table_vec);
+    drain_page_pool(&pool->page_pool);
+    close_page_pool_spill_file(&pool->page_pool);
 }
 
 Record *new_record(int field_count)
@@ -86,7 +195,7 @@ Record *new_record(int field_count)
     Record *record = (Record *)malloc(sizeof(Record));
     record->field_count = field_count;
     record->field_vec = new_vector(sizeof(Record_Field), field_count);
-    record->dymem_data = dymem_init(KB(128));
+    record->dymem_data = dymem_init_growing(NULL, KB(1), KB(128));
 
     return record;
 }
@@ -100,20 +209,257 @@ void delete_record(Record *record)
 
 Table *new_table_from_table_pool(Table_Pool *pool, const char *name, int col_count)
 {
-    Table *table = (Table *)vec_push_empty(pool->table_vec);
+    Table *table = NULL;
+
+    // Reuse the slot of a released table, if there is one.
+    if (pool->table_count < pool->table_vec->len) {
+        Vector_Iter *iter = new_vector_iter(pool->table_vec);
+        Table *slot = NULL;
+        vec_loop (iter, Table, slot) {
+            if (NULL == slot->data_mem) {
+                table = slot;
+                break;
+            }
+        } delete_vector_iter(iter);
+    }
+    if (NULL == table) {
+        table = (Table *)vec_push_empty(pool->table_vec);
+    }
     ++pool->table_count;
 
     table->col_count = col_count;
     table->row_count = 0;
-    table->name = name;
     table->data_mem = (Table_Memory *)malloc(sizeof(Table_Memory));
-    table->data_mem->dymem_bin_data = dymem_init(MB(2));
-    table->data_mem->dymem_str_data = dymem_init(MB(2));
-    table->data_mem->dymem_meta_data = dymem_init(KB(1));
-    table->column_vec = new_vector(sizeof(Table_Column), 10);
+    table->data_mem->dymem_meta_data = dymem_init_in_page_pool(&pool->page_pool, KB(1));
+
+    // The name may belong to a statement that will be reset, so keep a copy.
+    char *name_copy = (char *)dymem_allocate(table->data_mem->dymem_meta_data, strlen(name) + 1);
+    strcpy(name_copy, name);
+    table->name = name_copy;
+    table->column_vec = new_vector_in_page_pool(&pool->page_pool, sizeof(Table_Column), 10, 0);
+    table->window = NULL;
+    table->loader = NULL;
+    table->cache_key = NULL;
+    table->sql = NULL;
+    table->load_stats = (Load_Stats){ 0 };
+    table->ref_count = 1;
+    table->db_version = (Db_Version){ 0 };
+    table->last_use = ++pool->use_count;
     return table;
 }
 
+void release_table_from_table_pool(Table_Pool *pool, Table *table)
+{
+    cancel_table_loader(table);
+
+    Vector_Iter *iter = new_vector_iter(table->column_vec);
+    Table_Column *column = NULL;
+
+    vec_loop (iter, Table_Column, column) {
+        free_column_data(column);
+    } delete_vector_iter(iter);
+
+    if (NULL != table->window) {
+        release_cached_query(table->window->rows_stmt);
+        release_cached_query(table->window->rows_before_stmt);
+        release_cached_query(table->window->row_key_stmt);
+        release_cached_query(table->window->row_count_stmt);
+        delete_vector(table->window->row_key_vec);
+        free(table->window);
+        table->window = NULL;
+    }
+
+    delete_vector(table->column_vec);
+    dymem_free(table->data_mem->dymem_meta_data);
+    free(table->data_mem);
+
+    // Mark the slot as free.
+    table->data_mem = NULL;
+    table->column_vec = NULL;
+    table->col_count = 0;
+    table->row_count = 0;
+    table->cache_key = NULL;
+    --pool->table_count;
+}
+
+// Drop a reference to a table.  An unreferenced table stays in the pool for
+// reuse, unless it cannot be reused.
+void unref_table_from_table_pool(Table_Pool *pool, Table *table)
+{
+    assert(table->ref_count > 0);
+    --table->ref_count;
+    if (!table->ref_count && NULL == table->cache_key) {
+        release_table_from_table_pool(pool, table);
+    }
+}
+
+// Mark a table as the most recently used.
+void touch_table_in_table_pool(Table_Pool *pool, Table *table)
+{
+    table->last_use = ++pool->use_count;
+}
+
+int table_pool_is_over_budget(Table_Pool *pool)
+{
+    if (!pool->max_bytes) {
+        return 0;
+    }
+    Memory_Stats stats = memory_stats_from_table_pool(pool);
+    return memory_in_use(&stats) > pool->max_bytes;
+}
+
+// Report that the load of a table was stopped to keep the pool within its
+// budget.  The rows loaded are kept, but the table is not reused, as it is
+// incomplete.
+void report_table_load_over_budget(Table_Pool *pool, Table *table)
+{
+    char budget_text[32];
+    table->cache_key = NULL;
+    format_byte_count(budget_text, sizeof(budget_text), pool->max_bytes);
+    report_error("Memory budget of %s reached; stopped loading %s after %d rows.",
+                 budget_text, table->name, table->row_count);
+}
+
+// Page out the cells and data of a column.  The text formatted for display
+// is kept, as it belongs to the main thread.
+void page_out_table_column(Table_Column *column)
+{
+    page_out_vector(column->cell_vec);
+    page_out_dymem(column->dymem_str_data);
+    page_out_dymem(column->dymem_bin_data);
+}
+
+// Only the thread loading the table, if any, may call this.
+void page_out_table(Table *table)
+{
+    loop (col_idx, table->col_count) {
+        page_out_table_column((Table_Column *)vec_seek(table->column_vec, col_idx));
+    }
+}
+
+// Page out every table in the pool that is not loading.
+void page_out_table_pool(Table_Pool *pool)
+{
+    Vector_Iter *iter = new_vector_iter(pool->table_vec);
+    Table *table = NULL;
+
+    vec_loop (iter, Table, table) {
+        if (NULL != table->data_mem && !poll_table_loader(table)) {
+            page_out_table(table);
+        }
+    } delete_vector_iter(iter);
+}
+
+// Release the least recently used unreferenced tables, until no more than
+// TABLE_POOL_MAX_IDLE_TABLES remain and the pool is within its budget.
+void trim_table_pool(Table_Pool *pool)
+{
+    for (;;) {
+        Vector_Iter *iter = new_vector_iter(pool->table_vec);
+        Table *table = NULL;
+        Table *lru_table = NULL;
+        int idle_count = 0;
+
+        vec_loop (iter, Table, table) {
+            if (NULL != table->data_mem && !table->ref_count) {
+                ++idle_count;
+                if (NULL == lru_table || table->last_use < lru_table->last_use) {
+                    lru_table = table;
+                }
+            }
+        } delete_vector_iter(iter);
+
+        if (NULL == lru_table
+        ||  (idle_count <= TABLE_POOL_MAX_IDLE_TABLES && !table_pool_is_over_budget(pool))) {
+            break;
+        }
+        release_table_from_table_pool(pool, lru_table);
+    }
+}
+
+Db_Version db_version_using_sqlite(sqlite3 *db)
+{
+    Db_Version version = { -1, -1, sqlite3_total_changes64(db) };
+    sqlite3_stmt *stmt = NULL;
+
+    if (!prepare_cached_query_using_sqlite(db, &stmt, "pragma data_version;")) {
+        if (SQLITE_ROW == sqlite3_step(stmt)) {
+            version.data_version = sqlite3_column_int(stmt, 0);
+        }
+        release_cached_query(stmt);
+    }
+    if (!prepare_cached_query_using_sqlite(db, &stmt, "pragma schema_version;")) {
+        if (SQLITE_ROW == sqlite3_step(stmt)) {
+            version.schema_version = sqlite3_column_int(stmt, 0);
+        }
+        release_cached_query(stmt);
+    }
+    return version;
+}
+
+void set_table_cache_key(Table *table, sqlite3 *db, const char *key)
+{
+    table->cache_key = dymem_strdup(table->data_mem->dymem_meta_data, key);
+    table->db_version = db_version_using_sqlite(db);
+}
+
+// Find a table loaded from key, and take a reference to it.  Returns NULL if
+// there is none, or if the database has changed since it was loaded.
+Table *find_table_from_table_pool(Table_Pool *pool, sqlite3 *db, const char *key)
+{
+    Vector_Iter *iter = new_vector_iter(pool->table_vec);
+    Table *table = NULL;
+    Table *found_table = NULL;
+    Db_Version version = db_version_using_sqlite(db);
+
+    vec_loop (iter, Table, table) {
+        if (NULL == table->data_mem
+        ||  NULL == table->cache_key
+        ||  0 != strcmp(key, table->cache_key)) {
+            continue;
+        }
+        if (table->db_version.data_version != version.data_version
+        ||  table->db_version.schema_version != version.schema_version
+        ||  table->db_version.change_count != version.change_count) {
+            // Out of date, so it must never be reused.
+            table->cache_key = NULL;
+            if (!table->ref_count) {
+                release_table_from_table_pool(pool, table);
+            }
+            continue;
+        }
+        found_table = table;
+        ++found_table->ref_count;
+        found_table->last_use = ++pool->use_count;
+        break;
+    } delete_vector_iter(iter);
+
+    return found_table;
+}
+
+// Create the memory for a column's cells.
+void init_column_data(Table_Column *column, Page_Pool *page_pool)
+{
+    column->cell_vec = new_vector_in_page_pool(page_pool, sizeof(Table_Cell), 200, 1);
+    column->dymem_bin_data = dymem_init_growing(page_pool, COLUMN_INIT_PAGE_SIZE, COLUMN_MAX_PAGE_SIZE);
+    column->dymem_str_data = dymem_init_growing(page_pool, COLUMN_INIT_PAGE_SIZE, COLUMN_MAX_PAGE_SIZE);
+    column->dymem_view_data = dymem_init_growing(page_pool, KB(1), COLUMN_MAX_PAGE_SIZE);
+    column->index = NULL;
+    column->width_stats = (Column_Width_Stats){ 0 };
+    column->dictionary = (Column_Dictionary){ 0 };
+    column->cell_count = 0;
+}
+
+void free_column_data(Table_Column *column)
+{
+    delete_vector(column->cell_vec);
+    dymem_free(column->dymem_bin_data);
+    dymem_free(column->dymem_str_data);
+    dymem_free(column->dymem_view_data);
+    free_column_index(column);
+    clear_column_dictionary(&column->dictionary);
+}
+
 Table_Column *new_column_from_table(Table *table, const int type, const char *name, size_t name_len)
 {
     Table_Column *column = (Table_Column *)vec_push_empty(table->column_vec);
@@ -121,26 +467,71 @@ Table_Column *new_column_from_table(Table *table, const int type, const char *na
             table->data_mem->dymem_meta_data,
             name_len + 1);
     strcpy(column->name, name);
+    column->name_hash = hash_str_nocase(column->name);
     column->type = type;
 
     column->is_not_null = 0;
     column->is_pk = 0;
     column->is_read_only = 0;
-    column->fk_table = NULL;
-    column->fk_column = NULL;
+    column->fk_table_name = NULL;
+    column->fk_column_name = NULL;
 
-    column->cell_vec = new_vector(sizeof(Table_Cell), 200);
-    column->cell_count = 0;
+    init_column_data(column, table->column_vec->page_pool);
     return column;
 }
 
+// As in SQLite, column names are not case sensitive.
 Table_Column *column_by_name_from_table(Table *table, const char *name)
+{
+    Vector_Iter *iter = new_vector_iter(table->column_vec);
+    Table_Column *col = NULL;
+    uint32_t hash = hash_str_nocase(name);
+
+    vec_loop (iter, Table_Column, col) {
+        if (hash == col->name_hash && 0 == sqlite3_stricmp(name, col->name)) {
+            delete_vector_iter(iter);
+            return col;
+        }
+    }
+
+    delete_vector_iter(iter);
+    return NULL;
+}
+
+Table_Column *pk_column_from_table(Table *table)
 {
     Vector_Iter *iter = new_vector_iter(table->column_vec);
     Table_Column *col = NULL;
 
     vec_loop (iter, Table_Column, col) {
-        if (0 == strcmp(name, col->name)) {
+        if (col->is_pk) {
+            delete_vector_iter(iter);
+            return col;
+        }
+    }
+
+    delete_vector_iter(iter);
+    return NULL;
+}
+
+// The column of fk_table that the foreign key in column refers to.
+Table_Column *fk_column_from_table(Table *fk_table, Table_Column *column)
+{
+    if (NULL == column->fk_column_name) {
+        return pk_column_from_table(fk_table);
+    }
+    return column_by_name_from_table(fk_table, column->fk_column_name);
+}
+
+// The column that best describes a row to a reader: the first text column
+// that is not a key.
+Table_Column *label_column_from_table(Table *table)
+{
+    Vector_Iter *iter = new_vector_iter(table->column_vec);
+    Table_Column *col = NULL;
+
+    vec_loop (iter, Table_Column, col) {
+        if (DYTYPE_TEXT == col->type && !col->is_pk && NULL == col->fk_table_name) {
             delete_vector_iter(iter);
             return col;
         }
@@ -158,81 +549,198 @@ Table_Cell *allocate_cell_from_table_column(Table_Column *column)
     return cell;
 }
 
-// TODO: Implement way to release memory.
+// Record the display width of a cell in the stats of its column.  A column
+// is only loaded by one thread at a time, but the main thread may read the
+// stats while another thread loads it.
+void record_cell_width(Column_Width_Stats *stats, int width)
+{
+    int bin = width < COLUMN_WIDTH_HIST_SIZE? width : COLUMN_WIDTH_HIST_SIZE - 1;
+    __atomic_fetch_add(&stats->width_hist[bin], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->cell_count, 1, __ATOMIC_RELAXED);
+    if (width > __atomic_load_n(&stats->max_width, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&stats->max_width, width, __ATOMIC_RELAXED);
+    }
+}
+
+void merge_width_stats(Column_Width_Stats *stats, Column_Width_Stats *src)
+{
+    loop (bin, COLUMN_WIDTH_HIST_SIZE) {
+        __atomic_fetch_add(&stats->width_hist[bin], src->width_hist[bin], __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&stats->cell_count, src->cell_count, __ATOMIC_RELAXED);
+    if (src->max_width > __atomic_load_n(&stats->max_width, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&stats->max_width, src->max_width, __ATOMIC_RELAXED);
+    }
+}
+
+// The width that percent of the cells of a column fit in.
+int width_percentile(Column_Width_Stats *stats, int percent)
+{
+    int cell_count = __atomic_load_n(&stats->cell_count, __ATOMIC_RELAXED);
+    int threshold = (cell_count * percent + 99) / 100;
+    int counted = 0;
+
+    loop (bin, COLUMN_WIDTH_HIST_SIZE - 1) {
+        counted += __atomic_load_n(&stats->width_hist[bin], __ATOMIC_RELAXED);
+        if (counted >= threshold) {
+            return bin;
+        }
+    }
+    return __atomic_load_n(&stats->max_width, __ATOMIC_RELAXED);
+}
+
+void measure_table_cell(Table_Column *column, Table_Cell *cell)
+{
+    size_t fit_size = 0;
+    int width = utf8_display_width(cell->str_data, cell->str_size, COLUMN_MAX_WIDTH, &fit_size);
+    cell->display_width = width < UINT16_MAX? width : UINT16_MAX;
+    cell->fit_size = fit_size;
+}
+
+int int64_display_width(int64_t value)
+{
+    uint64_t magnitude = value < 0? -(uint64_t)value : (uint64_t)value;
+    int width = value < 0? 2 : 1;
+    while (magnitude >= 10) {
+        magnitude /= 10;
+        ++width;
+    }
+    return width;
+}
+
+// Show a cell that has no text of its own, such as a NULL, as the label.
+// The label is shared by every such cell, and must never be written to.
+void set_table_cell_label(Table_Cell *cell, const char *label)
+{
+    cell->str_data = (char *)label;
+    cell->str_size = strlen(label);
+    cell->display_width = cell->str_size;
+    cell->fit_size = cell->str_size;
+}
+
+// Copy a value of a row of stmt into a new cell of column.  row_key_idx is
+// the column of stmt holding the rowid of the row, or -1 if there is none,
+// when values are copied in full.  If there is, stmt was prepared from
+// new_preview_select_sql, so the length of the value is in the column
+// table->col_count after it.
 Table_Cell *new_cell_from_table_using_sqlite_row(
         Table *table,
         Table_Column *column,
         sqlite3_stmt *stmt,
-        int col_idx)
+        int col_idx,
+        int row_key_idx)
 {
     Table_Cell *datacell = allocate_cell_from_table_column(column);
-    Table_Memory *mem = table->data_mem;
     datacell->type = dytype_from_sqlite(sqlite3_column_type(stmt, col_idx));
+    datacell->dict_code = 0;
+    datacell->is_partial = 0;
+
+    sqlite3_int64 db_size = 0;
+    if (row_key_idx >= 0) {
+        db_size = sqlite3_column_int64(stmt, col_idx + table->col_count);
+    }
 
     switch (datacell->type) {
         case DYTYPE_NULL:
-            datacell->str_size = 4;
-            datacell->str_data = (char *)dymem_allocate(mem->dymem_str_data, datacell->str_size + 1);
-            strcpy(datacell->str_data, "NULL");
-
+            set_table_cell_label(datacell, "NULL");
             datacell->raw_size = 0;
             datacell->raw_data = NULL;
             break;
 
         case DYTYPE_INT:
-            datacell->raw_size = sizeof(int);
-            datacell->raw_data = (int *)dymem_allocate(mem->dymem_bin_data, datacell->raw_size);
-            *(int *)datacell->raw_data = sqlite3_column_int(stmt, col_idx);
-
-            datacell->str_data = (char *)dymem_allocate(mem->dymem_str_data, TEXT_LEN_FOR_LARGEST_INT);
-            strcpy(datacell->str_data, sqlite3_column_text(stmt, col_idx));
-            datacell->str_size = strlen(datacell->str_data);
+            // Numbers are formatted as text when they are first displayed.
+            // See str_from_table_cell.
+            datacell->data_as_int = sqlite3_column_int64(stmt, col_idx);
+            datacell->str_data = NULL;
+            datacell->str_size = 0;
+            datacell->display_width = int64_display_width(datacell->data_as_int);
+            datacell->fit_size = datacell->display_width;
             break;
 
         case DYTYPE_FLOAT:
-            datacell->raw_size = sizeof(double);
-            datacell->raw_data = (double *)dymem_allocate(mem->dymem_bin_data, datacell->raw_size);
-            *(double *)datacell->raw_data = sqlite3_column_double(stmt, col_idx);
-
-            datacell->str_data = (char *)dymem_allocate(mem->dymem_str_data, TEXT_LEN_FOR_LARGEST_FLOAT);
-            strcpy(datacell->str_data, (char *)sqlite3_column_text(stmt, col_idx));
-            datacell->str_size = strlen(datacell->str_data);
-
-
+            datacell->data_as_float = sqlite3_column_double(stmt, col_idx);
+            datacell->str_data = NULL;
+            datacell->str_size = 0;
+            datacell->display_width = FLOAT_DISPLAY_WIDTH;
+            datacell->fit_size = FLOAT_DISPLAY_WIDTH;
             break;
-        case DYTYPE_BLOB:
-            datacell->str_size = 4;
-            datacell->str_data = (char *)dymem_allocate(mem->dymem_str_data, datacell->str_size + 1);
-            strcpy(datacell->str_data, "BLOB");
 
+        case DYTYPE_BLOB:
+            set_table_cell_label(datacell, "BLOB");
             datacell->raw_size = sqlite3_column_bytes(stmt, col_idx);
-            datacell->raw_data = (void *)dymem_allocate(mem->dymem_bin_data, datacell->raw_size);
+            if (db_size > CELL_MAX_COPY_SIZE) {
+                datacell->raw_size = db_size;
+                datacell->is_partial = 1;
+                datacell->row_key = sqlite3_column_int64(stmt, row_key_idx);
+                break;
+            }
+            datacell->raw_data = (void *)dymem_allocate(column->dymem_bin_data, datacell->raw_size);
             memcpy(datacell->raw_data, sqlite3_column_blob(stmt, col_idx), datacell->raw_size);
             break;
 
-        case DYTYPE_TEXT:
+        case DYTYPE_TEXT: {
+            const char *text = (const char *)sqlite3_column_text(stmt, col_idx);
             datacell->str_size = sqlite3_column_bytes(stmt, col_idx);
             datacell->raw_size = datacell->str_size + 1;
             datacell->raw_data = NULL;
 
-            datacell->str_data = (char *)dymem_allocate(mem->dymem_str_data, datacell->raw_size);
-            strcpy(datacell->str_data, sqlite3_column_text(stmt, col_idx));
-            break;
+            if (db_size > CELL_MAX_COPY_SIZE) {
+                // Keep whole characters of the preview.
+                size_t preview_size = MIN(CELL_PREVIEW_SIZE, datacell->str_size);
+                while (preview_size > 0 && 0x80 == (text[preview_size] & 0xc0)) {
+                    --preview_size;
+                }
+                datacell->raw_size = db_size;
+                datacell->is_partial = 1;
+                datacell->row_key = sqlite3_column_int64(stmt, row_key_idx);
+                datacell->str_size = preview_size;
+                datacell->str_data = (char *)dymem_allocate(column->dymem_str_data, preview_size + 1);
+                memcpy(datacell->str_data, text, preview_size);
+                datacell->str_data[preview_size] = '\0';
+                measure_table_cell(column, datacell);
+            } else if (!intern_table_cell_text(column, datacell, text)) {
+                datacell->str_data = (char *)dymem_allocate(column->dymem_str_data, datacell->raw_size);
+                memcpy(datacell->str_data, text, datacell->raw_size);
+                measure_table_cell(column, datacell);
+            }
+        } break;
 
         default: // Unknown sqlite type
             datacell->type = DYTYPE_UNKNOWN;
-
+            set_table_cell_label(datacell, "UNKNOWN");
             datacell->raw_size = 0;
             datacell->raw_data = NULL;
-
-            datacell->str_size = 7;
-            datacell->str_data = (char *)dymem_allocate(mem->dymem_str_data, datacell->str_size + 1);
-            strcpy(datacell->str_data, "UNKNOWN");
     }
 
+    record_cell_width(&column->width_stats, datacell->display_width);
+
     return datacell;
 }
 
+const char *str_from_table_cell(Table_Column *column, Table_Cell *cell)
+{
+    if (NULL == cell->str_data) {
+        char buf[TEXT_LEN_FOR_LARGEST_FLOAT + 1];
+
+        switch (cell->type) {
+            case DYTYPE_INT:
+                cell->str_size = format_int64(buf, cell->data_as_int);
+                break;
+            case DYTYPE_FLOAT:
+                cell->str_size = format_double(buf, cell->data_as_float);
+                break;
+            default:
+                // Only numbers are formatted lazily.
+                assert(0);
+        }
+        cell->str_data = (char *)dymem_allocate(column->dymem_view_data, cell->str_size + 1);
+        memcpy(cell->str_data, buf, cell->str_size + 1);
+        cell->display_width = cell->str_size;
+        cell->fit_size = cell->str_size < COLUMN_MAX_WIDTH? cell->str_size : COLUMN_MAX_WIDTH;
+    }
+    return cell->str_data;
+}
+
 void new_columns_for_table_using_sqlite(Table *table, sqlite3 *db, sqlite3_stmt *stmt)
 {
     // Create columns and populate their names.
@@ -252,38 +760,62 @@ void new_columns_for_table_using_sqlite(Table *table, sqlite3 *db, sqlite3_stmt
 
 void handle_sqlite_step_status(sqlite3 *db, int status)
 {
-    // TODO: Roll these messages into the event loop so we can see them in the status bar.
     switch (status) {
-    case SQLITE_DONE: printw("Success: Done.\n"); break;
+    case SQLITE_DONE: break;
     case SQLITE_MISUSE:
-        printw("Error (SQLITE_MISUSE) stepping through statement: %s\n", sqlite3_errmsg(db));
+        report_error("Error (SQLITE_MISUSE) stepping through statement: %s", sqlite3_errmsg(db));
         break;
     default:
-        printw("Error (%d) stepping through statement: %s\n", status, sqlite3_errmsg(db));
+        report_error("Error (%d) stepping through statement: %s", status, sqlite3_errmsg(db));
     }
 }
 
-void populate_table_using_sqlite(Table *table, sqlite3 *db, sqlite3_stmt *stmt)
+// Load the rows of stmt into table, stopping after row_limit rows unless it
+// is 0.
+void populate_table_using_sqlite(Table *table, sqlite3 *db, sqlite3_stmt *stmt, int row_limit)
 {
+    Table_Pool *pool = global_table_pool;
+    Load_Stats *stats = &table->load_stats;
+    Load_Timer timer;
     int status = 0;
-    Table_Column *column = NULL;
-    Table_Cell *cell = NULL;
-
-    // Populate data.
-    for (int col_idx = 0; status = sqlite3_step(stmt); ++col_idx) {
-        if (SQLITE_ROW == status) {
-            loop (col_idx, table->col_count) {
-                Table_Column *column = vec_seek(table->column_vec, col_idx);
-                cell = new_cell_from_table_using_sqlite_row(
-                    table,
-                    column,
-                    stmt,
-                    col_idx
-                );
+
+    start_load_timer(&timer);
+    while (SQLITE_ROW == (status = sqlite3_step(stmt))) {
+        int is_sampled = begin_load_timer_row(&timer);
+        loop (col_idx, table->col_count) {
+            Table_Cell *cell = new_cell_from_table_using_sqlite_row(
+                table,
+                vec_seek(table->column_vec, col_idx),
+                stmt,
+                col_idx,
+                -1
+            );
+            stats->bytes_copied += table_cell_data_size(cell);
+        }
+        ++table->row_count;
+        end_load_timer_row(&timer, is_sampled);
+        if (table->row_count == row_limit) break;
+
+        // The main loop cannot keep the pool within its budget until this
+        // returns, so the load does.
+        if (0 == table->row_count % TABLE_LOADER_BATCH_SIZE && table_pool_is_over_budget(pool)) {
+            if (-1 != pool->page_pool.spill_fd) {
+                page_out_table(table);
+            } else {
+                __atomic_store_n(&pool->is_over_budget, 1, __ATOMIC_RELAXED);
             }
-            ++table->row_count;
-        } else { handle_sqlite_step_status(db, status); break; }
+        }
+        if (__atomic_load_n(&pool->is_over_budget, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&pool->is_over_budget, 0, __ATOMIC_RELAXED);
+            report_table_load_over_budget(pool, table);
+            break;
+        }
+    }
+    flush_load_timer(&timer, stats);
+    if (SQLITE_ROW != status) {
+        handle_sqlite_step_status(db, status);
     }
+    finish_table_load_stats(table);
 }
 
 int prepare_query_using_sqlite(sqlite3 *db, sqlite3_stmt **stmt, char *sql)
@@ -291,18 +823,424 @@ int prepare_query_using_sqlite(sqlite3 *db, sqlite3_stmt **stmt, char *sql)
     int err = 0;
     err = sqlite3_prepare_v2(db, sql, -1, stmt, NULL);
     if (err) {
-        // TODO: Roll this message into the event loop so we can see it in the status bar.
-        printw("Error preparing statement: %s\n", sqlite3_errmsg(db));
+        report_error("Error preparing statement: %s", sqlite3_errmsg(db));
+    }
+    return err;
+}
+
+// Remove every row, keeping the memory for reuse.
+void clear_table_rows(Table *table)
+{
+    const Dymem_Mark empty_mark = { NULL, 0 };
+    Vector_Iter *iter = new_vector_iter(table->column_vec);
+    Table_Column *column = NULL;
+
+    vec_loop (iter, Table_Column, column) {
+        vec_clear(column->cell_vec);
+        dymem_rewind(column->dymem_bin_data, empty_mark);
+        dymem_rewind(column->dymem_str_data, empty_mark);
+        dymem_rewind(column->dymem_view_data, empty_mark);
+        free_column_index(column);
+        clear_column_dictionary(&column->dictionary);
+        column->cell_count = 0;
+    } delete_vector_iter(iter);
+
+    table->row_count = 0;
+}
+
+// Load the window of rows starting at the row with the given rowid.
+void load_table_window(Table *table, sqlite3 *db, sqlite3_int64 first_key)
+{
+    Table_Window *window = table->window;
+    sqlite3_stmt *stmt = window->rows_stmt;
+    int status = 0;
+
+    clear_table_rows(table);
+    vec_clear(window->row_key_vec);
+
+    sqlite3_bind_int64(stmt, 1, first_key);
+    sqlite3_bind_int(stmt, 2, TABLE_WINDOW_SIZE);
+
+    Load_Stats *stats = &table->load_stats;
+    Load_Timer timer;
+
+    // The first column of the statement is the rowid.
+    start_load_timer(&timer);
+    while (SQLITE_ROW == (status = sqlite3_step(stmt))) {
+        int is_sampled = begin_load_timer_row(&timer);
+        sqlite3_int64 key = sqlite3_column_int64(stmt, 0);
+        vec_push(window->row_key_vec, &key);
+        loop (col_idx, table->col_count) {
+            Table_Cell *cell = new_cell_from_table_using_sqlite_row(
+                table,
+                vec_seek(table->column_vec, col_idx),
+                stmt,
+                col_idx + 1,
+                0
+            );
+            stats->bytes_copied += table_cell_data_size(cell);
+        }
+        ++table->row_count;
+        end_load_timer_row(&timer, is_sampled);
+    }
+    flush_load_timer(&timer, stats);
+    if (SQLITE_DONE != status) {
+        handle_sqlite_step_status(db, status);
+    }
+    window->is_at_end = table->row_count < TABLE_WINDOW_SIZE;
+
+    sqlite3_reset(stmt);
+    finish_table_load_stats(table);
+}
+
+// Move the window of a windowed table so that the cursor is at its centre, if
+// the cursor is near either edge.  The cursor and viewport are adjusted so
+// that they stay on the same rows.
+void slide_table_window_to_cursor(Table *table, View_Cursor *cursor)
+{
+    Table_Window *window = table->window;
+    if (NULL == window || !table->row_count) {
+        return;
+    }
+
+    if (cursor->row >= table->row_count - TABLE_WINDOW_MARGIN && !window->is_at_end) {
+        int shift = cursor->row - TABLE_WINDOW_SIZE / 2;
+        sqlite3_int64 first_key = *(sqlite3_int64 *)vec_seek(window->row_key_vec, shift);
+
+        begin_table_load_stats(table, monotonic_ns());
+        load_table_window(table, global_app_state.db, first_key);
+        window->row_offset += shift;
+        cursor->row -= shift;
+        cursor->first_row -= shift;
+        if (cursor->first_row < 0) cursor->first_row = 0;
+
+    } else if (cursor->row < TABLE_WINDOW_MARGIN && window->row_offset > 0) {
+        sqlite3_stmt *stmt = window->rows_before_stmt;
+        sqlite3_int64 first_key = *(sqlite3_int64 *)vec_seek(window->row_key_vec, 0);
+        int64_t start_ns = monotonic_ns();
+        int shift = 0;
+
+        // Walk back from the first row loaded to find the new first row.
+        sqlite3_bind_int64(stmt, 1, first_key);
+        sqlite3_bind_int(stmt, 2, TABLE_WINDOW_SIZE / 2 - cursor->row);
+        while (SQLITE_ROW == sqlite3_step(stmt)) {
+            first_key = sqlite3_column_int64(stmt, 0);
+            ++shift;
+        }
+        sqlite3_reset(stmt);
+
+        begin_table_load_stats(table, start_ns);
+        load_table_window(table, global_app_state.db, first_key);
+        window->row_offset -= shift;
+        cursor->row += shift;
+        cursor->first_row += shift;
+    }
+}
+
+// Position of the cursor's row in the whole table.
+int table_row_from_cursor(Table *table, View_Cursor *cursor)
+{
+    return NULL == table->window? cursor->row : table->window->row_offset + cursor->row;
+}
+
+int step_int64_using_sqlite(sqlite3_stmt *stmt, sqlite3_int64 *value)
+{
+    int has_row = SQLITE_ROW == sqlite3_step(stmt);
+    if (has_row) {
+        *value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_reset(stmt);
+    return has_row;
+}
+
+// Rows in the db table of a windowed table.  They are counted once, as the
+// viewer does not change the table, or found without the db once the last
+// row is loaded.  SQLite counts them by visiting every page of the table's
+// b-tree, so the first count takes time in proportion to the size of the
+// table.
+sqlite3_int64 count_table_window_rows(Table *table)
+{
+    Table_Window *window = table->window;
+    if (window->db_row_count < 0 && window->is_at_end) {
+        window->db_row_count = window->row_offset + table->row_count;
+    }
+    if (window->db_row_count < 0) {
+        window->db_row_count = 0;
+        step_int64_using_sqlite(window->row_count_stmt, &window->db_row_count);
+    }
+    return window->db_row_count;
+}
+
+// Load the last TABLE_WINDOW_SIZE rows of a windowed table.  They are found
+// by walking back from the end of the rowid b-tree, so only the rows loaded
+// are visited.  Returns 0 if the table is empty.
+int load_last_table_window(Table *table)
+{
+    Table_Window *window = table->window;
+    sqlite3_stmt *stmt = window->rows_before_stmt;
+    sqlite3_int64 first_key = 0;
+    int row_count = 0;
+
+    sqlite3_bind_int64(stmt, 1, INT64_MAX);
+    sqlite3_bind_int(stmt, 2, TABLE_WINDOW_SIZE);
+    while (SQLITE_ROW == sqlite3_step(stmt)) {
+        first_key = sqlite3_column_int64(stmt, 0);
+        ++row_count;
+    }
+    sqlite3_reset(stmt);
+    if (!row_count) {
+        return 0;
+    }
+
+    load_table_window(table, global_app_state.db, first_key);
+    window->row_offset = MAX(count_table_window_rows(table) - table->row_count, 0);
+    // A full window can end the table too.
+    window->is_at_end = 1;
+    return 1;
+}
+
+// Move the cursor to a row of the table, given by its position in the whole
+// table rather than in the window, or to the last row if the table has
+// fewer rows.  A row in the window is reached without going to the db.
+//
+// For a row outside it, the window is loaded around that row.  The rows of
+// the db table are counted, once, to find where its end is.  A window that
+// would reach the end is loaded by walking back from the last rowid, so G
+// visits only the rows it loads, apart from that count.  For any other row,
+// SQLite finds the rowid at the position with an offset, which steps over
+// every row before it in the rowid b-tree, so the cost of the jump grows
+// with the position of the row.
+void seek_table_cursor_to_row(Table *table, View_Cursor *cursor, int row)
+{
+    Table_Window *window = table->window;
+    int row_count = loaded_row_count(table);
+
+    if (row < 0) row = 0;
+    if (NULL == window) {
+        cursor->row = row < row_count? row : MAX(row_count - 1, 0);
+        return;
+    }
+
+    int window_row = row - window->row_offset;
+    if (window_row >= 0 && (window_row < row_count || window->is_at_end)) {
+        cursor->row = window_row < row_count? window_row : MAX(row_count - 1, 0);
+        slide_table_window_to_cursor(table, cursor);
+        return;
+    }
+
+    int64_t start_ns = monotonic_ns();
+    sqlite3_int64 db_row_count = count_table_window_rows(table);
+    if (!db_row_count) {
+        return;
+    }
+    if (row >= db_row_count) {
+        row = MAX(db_row_count - 1, 0);
+    }
+
+    int first_row = MAX(row - TABLE_WINDOW_SIZE / 2, 0);
+    if (first_row + TABLE_WINDOW_SIZE >= db_row_count) {
+        begin_table_load_stats(table, start_ns);
+        if (load_last_table_window(table)) {
+            cursor->row = MIN(row - window->row_offset, MAX(table->row_count - 1, 0));
+        }
+        return;
+    }
+
+    sqlite3_int64 first_key = 0;
+    sqlite3_bind_int(window->row_key_stmt, 1, first_row);
+    if (!step_int64_using_sqlite(window->row_key_stmt, &first_key)) {
+        return;  // The table is empty.
+    }
+
+    begin_table_load_stats(table, start_ns);
+    load_table_window(table, global_app_state.db, first_key);
+    window->row_offset = first_row;
+    cursor->row = MIN(row - first_row, MAX(table->row_count - 1, 0));
+}
+
+void bind_table_cell_using_sqlite(sqlite3_stmt *stmt, int param_idx, Table_Column *column, Table_Cell *cell)
+{
+    switch (cell->type) {
+        case DYTYPE_INT:
+            sqlite3_bind_int64(stmt, param_idx, cell->data_as_int);
+            break;
+        case DYTYPE_FLOAT:
+            sqlite3_bind_double(stmt, param_idx, cell->data_as_float);
+            break;
+        default:
+            sqlite3_bind_text(stmt, param_idx, str_from_table_cell(column, cell), cell->str_size, SQLITE_STATIC);
+    }
+}
+
+// Prepare a query for the first row of a windowed table whose value in
+// column equals the key cell, from the db rather than the rows loaded.  The
+// query selects result, an SQL expression.  Returns an error if there can
+// be no such row.
+int prepare_key_query_using_sqlite(sqlite3_stmt **stmt, const char *result, Table *table, Table_Column *column, Table_Column *key_column, Table_Cell *key_cell)
+{
+    char sql[512];
+    if (!is_cell_indexable(key_cell)) {
+        return 1;
+    }
+    snprintf(sql, sizeof(sql), "select %s from %s where %s = ?1 order by rowid limit 1;",
+             result, table->name, column->name);
+    int err = prepare_cached_query_using_sqlite(global_app_state.db, stmt, sql);
+    if (!err) {
+        bind_table_cell_using_sqlite(*stmt, 1, key_column, key_cell);
     }
     return err;
 }
 
+// Load the window of a windowed table around the first row whose value in
+// column equals the key cell, for a row that is not loaded, as when a
+// foreign key refers to a row beyond the window.  The row is found through
+// the db, but its position in the table is found by counting the rows
+// before it, which visits each of their rowids.  Returns the row in the
+// window, or -1 if the table has no such row.
+int seek_table_window_to_key_using_sqlite(Table *table, Table_Column *column, Table_Column *key_column, Table_Cell *key_cell)
+{
+    Table_Window *window = table->window;
+    sqlite3_stmt *stmt = NULL;
+    sqlite3_int64 row_key = 0;
+    sqlite3_int64 row = 0;
+    char sql[255];
+
+    int64_t start_ns = monotonic_ns();
+    if (prepare_key_query_using_sqlite(&stmt, "rowid", table, column, key_column, key_cell)) {
+        return -1;
+    }
+    int has_row = step_int64_using_sqlite(stmt, &row_key);
+    release_cached_query(stmt);
+    if (!has_row) {
+        return -1;
+    }
+
+    sprintf(sql, "select count(*) from %s where rowid < ?1;", table->name);
+    if (prepare_cached_query_using_sqlite(global_app_state.db, &stmt, sql)) {
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, row_key);
+    step_int64_using_sqlite(stmt, &row);
+    release_cached_query(stmt);
+
+    // Walk back from the row to find the first row of the window.
+    sqlite3_int64 first_key = row_key;
+    int shift = 0;
+    stmt = window->rows_before_stmt;
+    sqlite3_bind_int64(stmt, 1, row_key);
+    sqlite3_bind_int(stmt, 2, TABLE_WINDOW_SIZE / 2);
+    while (SQLITE_ROW == sqlite3_step(stmt)) {
+        first_key = sqlite3_column_int64(stmt, 0);
+        ++shift;
+    }
+    sqlite3_reset(stmt);
+
+    begin_table_load_stats(table, start_ns);
+    load_table_window(table, global_app_state.db, first_key);
+    window->row_offset = (int)row - shift;
+    return shift < table->row_count? shift : -1;
+}
+
+// Write the text of label_column in the first row of a windowed table whose
+// value in column equals the key cell to buf, reading it from the db, for a
+// row that is not loaded.  Returns 0 if the table has no such row.
+int label_from_table_using_sqlite(Table *table, Table_Column *column, Table_Column *label_column, Table_Column *key_column, Table_Cell *key_cell, char *buf, size_t buf_size)
+{
+    sqlite3_stmt *stmt = NULL;
+    if (prepare_key_query_using_sqlite(&stmt, label_column->name, table, column, key_column, key_cell)) {
+        return 0;
+    }
+    int has_row = SQLITE_ROW == sqlite3_step(stmt);
+    if (has_row) {
+        const char *label = (const char *)sqlite3_column_text(stmt, 0);
+        snprintf(buf, buf_size, "%s", NULL != label? label : "NULL");
+    }
+    release_cached_query(stmt);
+    return has_row;
+}
+
+// Returns SQL selecting the rowid of each row of table, then a preview of
+// each value, then the length of each value, followed by tail_sql.  A text
+// longer than CELL_MAX_COPY_SIZE is cut to CELL_PREVIEW_SIZE characters, and
+// a longer BLOB is replaced by an empty one, as only its length is shown.
+// Free it with sqlite3_free.
+char *new_preview_select_sql(Table *table, const char *tail_sql)
+{
+    sqlite3_str *str = sqlite3_str_new(NULL);
+    sqlite3_str_appendall(str, "select rowid");
+    loop (col_idx, table->col_count) {
+        Table_Column *column = vec_seek(table->column_vec, col_idx);
+        sqlite3_str_appendf(str,
+                ", case when length(\"%w\") > %d then"
+                " case when typeof(\"%w\") = 'text' then substr(\"%w\", 1, %d) else x'' end"
+                " else \"%w\" end",
+                column->name, CELL_MAX_COPY_SIZE,
+                column->name, column->name, CELL_PREVIEW_SIZE,
+                column->name);
+    }
+    loop (col_idx, table->col_count) {
+        Table_Column *column = vec_seek(table->column_vec, col_idx);
+        sqlite3_str_appendf(str, ", length(\"%w\")", column->name);
+    }
+    sqlite3_str_appendf(str, " from %s %s", table->name, tail_sql);
+    return sqlite3_str_finish(str);
+}
+
+int prepare_table_window_using_sqlite(Table *table, sqlite3 *db)
+{
+    char sql[255];
+    char *rows_sql = NULL;
+    int err = 0;
+    Table_Window *window = (Table_Window *)malloc(sizeof(Table_Window));
+
+    window->row_offset = 0;
+    window->is_at_end = 0;
+    window->db_row_count = -1;
+    window->rows_stmt = NULL;
+    window->rows_before_stmt = NULL;
+    window->row_key_stmt = NULL;
+    window->row_count_stmt = NULL;
+
+    rows_sql = new_preview_select_sql(table, "where rowid >= ?1 order by rowid limit ?2;");
+    err = prepare_cached_query_using_sqlite(db, &window->rows_stmt, rows_sql);
+    sqlite3_free(rows_sql);
+    if (!err) {
+        sprintf(sql, "select rowid from %s where rowid < ?1 order by rowid desc limit ?2;", table->name);
+        err = prepare_cached_query_using_sqlite(db, &window->rows_before_stmt, sql);
+    }
+    if (!err) {
+        sprintf(sql, "select rowid from %s order by rowid limit 1 offset ?1;", table->name);
+        err = prepare_cached_query_using_sqlite(db, &window->row_key_stmt, sql);
+    }
+    if (!err) {
+        sprintf(sql, "select count(*) from %s;", table->name);
+        err = prepare_cached_query_using_sqlite(db, &window->row_count_stmt, sql);
+    }
+    if (err) {
+        release_cached_query(window->rows_stmt);
+        release_cached_query(window->rows_before_stmt);
+        release_cached_query(window->row_key_stmt);
+        free(window);
+        return err;
+    }
+
+    window->row_key_vec = new_vector_in_page_pool(
+            table->column_vec->page_pool,
+            sizeof(sqlite3_int64),
+            TABLE_WINDOW_SIZE,
+            0);
+    table->window = window;
+
+    return 0;
+}
+
 int new_table_with_query_using_sqlite(Table **target_table, char *table_name, char *sql)
 {
     sqlite3 *db = global_app_state.db;
     sqlite3_stmt *tbl_stmt;
+    int64_t start_ns = monotonic_ns();
 
-    int err = prepare_query_using_sqlite(db, &tbl_stmt, sql);
+    int err = prepare_cached_query_using_sqlite(db, &tbl_stmt, sql);
     if (err) return err;
 
     int col_count = sqlite3_column_count(tbl_stmt);
@@ -311,37 +1249,84 @@ int new_table_with_query_using_sqlite(Table **target_table, char *table_name, ch
     // Load col data
     new_columns_for_table_using_sqlite(table, db, tbl_stmt);
 
-    populate_table_using_sqlite(table, db, tbl_stmt);
+    set_table_cache_key(table, db, sql);
+    table->sql = table->cache_key;
+    begin_table_load_stats(table, start_ns);
+    if (start_table_loader_using_sqlite(table, db, tbl_stmt, 0)) {
+        populate_table_using_sqlite(table, db, tbl_stmt, 0);
+    }
     *target_table = table;
 
-    sqlite3_finalize(tbl_stmt);
+    release_cached_query(tbl_stmt);
 
     return 0;
 }
 
+// Run SQL typed at the console into a new table, loading at most row_limit
+// rows unless it is 0.  Only a single statement that does not write to the
+// database is run.  On error, a message is written to err_buf.  The table is
+// not kept for reuse, so that running the query again reads the rows again.
+int new_table_with_console_query_using_sqlite(Table **target_table, const char *sql, int row_limit, char *err_buf, size_t err_len)
+{
+    sqlite3 *db = global_app_state.db;
+    sqlite3_stmt *stmt = NULL;
+    const char *tail = NULL;
+    int64_t start_ns = monotonic_ns();
+
+    int err = sqlite3_prepare_v2(db, sql, -1, &stmt, &tail);
+    if (err) {
+        snprintf(err_buf, err_len, "Error: %s", sqlite3_errmsg(db));
+        return err;
+    }
+    if (NULL == stmt) {
+        snprintf(err_buf, err_len, "Error: no SQL to run.");
+        return SQLITE_MISUSE;
+    }
+    while (NULL != tail && isspace((unsigned char)*tail)) ++tail;
+    if ('\0' != *tail) {
+        snprintf(err_buf, err_len, "Error: only one statement can be run at a time.");
+        sqlite3_finalize(stmt);
+        return SQLITE_MISUSE;
+    }
+    if (!sqlite3_stmt_readonly(stmt) || !sqlite3_column_count(stmt)) {
+        snprintf(err_buf, err_len, "Error: only queries that return rows and do not write can be run.");
+        sqlite3_finalize(stmt);
+        return SQLITE_READONLY;
+    }
+
+    Table *table = new_table_from_table_pool(global_table_pool, sql, sqlite3_column_count(stmt));
+    new_columns_for_table_using_sqlite(table, db, stmt);
+    table->sql = table->name;
+    begin_table_load_stats(table, start_ns);
+    if (start_table_loader_using_sqlite(table, db, stmt, row_limit)) {
+        populate_table_using_sqlite(table, db, stmt, row_limit);
+    }
+    *target_table = table;
+
+    sqlite3_finalize(stmt);
+    return 0;
+}
+
 int new_table_with_data_using_sqlite(Table **target_table, const char *table_name)
 {
     char sql[255];
     sqlite3 *db = global_app_state.db;
     sqlite3_stmt *data_stmt = NULL;
-    sqlite3_stmt *meta_stmt = NULL;
-    sqlite3_stmt *rel_stmt = NULL;
     int col_count = 0;
     int err = 0;
-    int status = 0;
 
-    // Query data.
-    sprintf(sql, "select * from %s;", table_name);
-    err = prepare_query_using_sqlite(db, &data_stmt, sql);
-    if (err) { return err; }
+    *target_table = find_table_from_table_pool(global_table_pool, db, table_name);
+    if (NULL != *target_table) {
+        return 0;
+    }
+    int64_t start_ns = monotonic_ns();
 
-    sprintf(sql, "select `from`, `to`, `table` from pragma_foreign_key_list('%s');", table_name);
-    err = prepare_query_using_sqlite(db, &rel_stmt, sql);
-    if (err) { return err; }
+    // Query data.  The table name cannot be bound, so is part of the SQL.
+    sprintf(sql, "select * from %s;", table_name);
+    err = prepare_cached_query_using_sqlite(db, &data_stmt, sql);
+    if (err) { goto cleanup; }
 
-    sprintf(sql, "select `name`, `notnull`, `pk` from pragma_table_info('%s')", table_name);
-    err = prepare_query_using_sqlite(db, &meta_stmt, sql);
-    if (err) { return err; }
+    Catalog_Table *catalog_table = find_catalog_table_using_sqlite(db, table_name);
 
     // Init table
     col_count = sqlite3_column_count(data_stmt);
@@ -349,68 +1334,69 @@ int new_table_with_data_using_sqlite(Table **target_table, const char *table_nam
     new_columns_for_table_using_sqlite(table, db, data_stmt);
 
     // Populate meta data
-    Table_Column *column = NULL;
-
-    for (int row_idx = 0; status = sqlite3_step(rel_stmt); ++row_idx) {
-        if (SQLITE_ROW == status) {
-
-            // For `from` column
-            column = column_by_name_from_table(
-                table,
-                sqlite3_column_text(rel_stmt, 0)
-            );
-            assert(NULL != column);
-
-            // For `table` column
-            err = new_table_with_data_using_sqlite(
-                &column->fk_table,
-                sqlite3_column_text(rel_stmt, 2)
-            );
-            if (err) { return err; }
-
-            // For `to` column
-            column->fk_column = column_by_name_from_table(
-                column->fk_table,
-                sqlite3_column_text(rel_stmt, 1)
-            );
-            assert(NULL != column);
-
-        } else { handle_sqlite_step_status(db, status); break; }
-    }
-
-    for (int row_idx = 0; status = sqlite3_step(meta_stmt); ++row_idx) {
-        if (SQLITE_ROW == status) {
-
-            // For `name` column
-            column = column_by_name_from_table(
-                table,
-                sqlite3_column_text(meta_stmt, 0)
-            );
-            assert(NULL != column);
-
-            // For `notnull` column
-            column->is_not_null = sqlite3_column_int(meta_stmt, 1);
-
-            // For `pk` column
-            column->is_pk = sqlite3_column_int(meta_stmt, 2);
+    if (NULL != catalog_table) {
+        loop (col_idx, catalog_table->col_count) {
+            Catalog_Column *catalog_column
+                = column_from_catalog_table(&global_schema_catalog, catalog_table, col_idx);
+            Table_Column *column = column_by_name_from_table(table, catalog_column->name);
+            if (NULL == column) {
+                // Hidden columns are not returned by `select *`.
+                continue;
+            }
 
+            column->is_not_null = catalog_column->is_not_null;
+            column->is_pk = catalog_column->is_pk;
             if (column->is_pk
             &&  column->is_not_null
             &&  DYTYPE_INT == column->type) {
                 column->is_read_only = 1;
             }
 
-
-        } else { handle_sqlite_step_status(db, status); break; }
+            // The catalog may be read again, so its names are copied.  The
+            // foreign key's table is only loaded if the key is followed.
+            if (NULL != catalog_column->fk_table_name) {
+                column->fk_table_name = dymem_strdup(
+                    table->data_mem->dymem_meta_data,
+                    catalog_column->fk_table_name
+                );
+            }
+            if (NULL != catalog_column->fk_column_name) {
+                column->fk_column_name = dymem_strdup(
+                    table->data_mem->dymem_meta_data,
+                    catalog_column->fk_column_name
+                );
+            }
+        }
     }
 
-    populate_table_using_sqlite(table, db, data_stmt);
+    set_table_cache_key(table, db, table_name);
+
+    int is_loaded = 0;
+    if (NULL != catalog_table && catalog_table->has_rowid) {
+        if (global_app_state.scan_worker_count > 1) {
+            begin_table_load_stats(table, start_ns);
+            is_loaded = !start_table_scan_using_sqlite(
+                    table, db, global_app_state.scan_worker_count);
+        } else if (!prepare_table_window_using_sqlite(table, db)) {
+            table->sql = dymem_strdup(table->data_mem->dymem_meta_data, sqlite3_sql(table->window->rows_stmt));
+            begin_table_load_stats(table, start_ns);
+            load_table_window(table, db, INT64_MIN);
+            is_loaded = 1;
+        }
+    }
+    if (NULL == table->sql) {
+        table->sql = dymem_strdup(table->data_mem->dymem_meta_data, sqlite3_sql(data_stmt));
+    }
+    if (!is_loaded) {
+        begin_table_load_stats(table, start_ns);
+    }
+    if (!is_loaded && start_table_loader_using_sqlite(table, db, data_stmt, 0)) {
+        populate_table_using_sqlite(table, db, data_stmt, 0);
+    }
     *target_table = table;
 
-    // Cleanup
-    sqlite3_finalize(data_stmt);
-    sqlite3_finalize(meta_stmt);
-    sqlite3_finalize(rel_stmt);
+cleanup:
+    release_cached_query(data_stmt);
 
-    return 0;
+    return err;
 }
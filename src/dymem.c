@@ -1,78 +1,202 @@
 Memory_Page *dymem_new_page(Dymem *mem, size_t init_len)
 {
-    return new_mem_page(init_len > mem->init_page_size? init_len : mem->init_page_size);
+    size_t page_size = mem->init_page_size;
+    for (int idx = 0; idx < mem->page_count && page_size < mem->max_page_size; ++idx) {
+        page_size *= 2;
+    }
+    if (page_size > mem->max_page_size) {
+        page_size = mem->max_page_size;
+    }
+
+    Memory_Page *page = take_mem_page(
+            mem->page_pool,
+            init_len > page_size? init_len : page_size);
+
+    if (NULL == mem->first_page) {
+        // We always assign the first page of memory on allocation, not
+        // initialisation.  We do this because, in theory, it's possible
+        // that the initial page size could always be too small for a
+        // dataset using it (e.g. video assets); in which case, the first
+        // page would never get used if it had been created on init.
+
+        mem->first_page = page;
+    } else {
+        mem->page_cursor->next = page;
+        page->prev = mem->page_cursor;
+        mem->tail_waste_bytes += mem->page_cursor->size - mem->page_cursor->used;
+    }
+    mem->page_cursor = page;
+    ++mem->page_count;
+    mem->reserved_bytes += page->size;
+    mem->mapped_bytes += mem_page_mapped_size(page);
+    mem->peak_bytes = MAX(mem->peak_bytes, mem->reserved_bytes);
+
+    return page;
 }
 
 void *dymem_allocate(struct dymem *mem, size_t len)
 {
-    Memory_Page *page = NULL;
-
     assert (NULL != mem);
-    if (NULL == mem->page_cursor) {
+
+    Memory_Page *page = mem->page_cursor;
+    if (NULL == page || page->used + len > page->size) {
         page = dymem_new_page(mem, len);
+    }
 
-        mem->page_cursor = page;
-        if (NULL == mem->first_page) {
-            // We always assign the first page of memory on allocation, not
-            // initialisation.  We do this because, in theory, it's possible
-            // that the initial page size could always be too small for a
-            // dataset using it (e.g. video assets); in which case, the first
-            // page would never get used if it had been created on init.
+    void *mem_cursor = page->cursor;
+    page->used += len;
+    page->cursor += len;
+    mem->requested_bytes += len;
 
-            mem->first_page = page;
-        }
-    } else {
-        page = mem->page_cursor;
+    // Used memory should never exceed page size.  If it has, a data
+    // corruption has occured and we must abort.
+    assert(page->used <= page->size);
+
+    return mem_cursor;
+}
+
+// align must be a power of 2.
+void *dymem_allocate_aligned(Dymem *mem, size_t len, size_t align)
+{
+    assert (NULL != mem);
+    assert (0 == (align & (align - 1)));
+
+    Memory_Page *page = mem->page_cursor;
+    size_t padding = 0;
+    if (NULL != page) {
+        padding = -(uintptr_t)page->cursor & (align - 1);
+    }
+    if (NULL == page || page->used + padding + len > page->size) {
+        page = dymem_new_page(mem, len + align - 1);
+        padding = -(uintptr_t)page->cursor & (align - 1);
     }
+    page->used += padding;
+    page->cursor += padding;
+
+    return dymem_allocate(mem, len);
+}
+
+char *dymem_strdup(Dymem *mem, const char *str)
+{
+    size_t len = strlen(str);
+    char *copy = (char *)dymem_allocate(mem, len + 1);
+    memcpy(copy, str, len + 1);
+    return copy;
+}
 
-    void *mem_cursor = NULL;
+Dymem_Mark dymem_mark(Dymem *mem)
+{
+    Dymem_Mark mark = { mem->page_cursor, 0, mem->requested_bytes, mem->tail_waste_bytes };
+    if (NULL != mark.page) {
+        mark.used = mark.page->used;
+    }
+    return mark;
+}
 
-    if (page->used + len > page->size) {
-        // Create page for new data.
-        Memory_Page *new_page = dymem_new_page(mem, len);
-        new_page->used = len;
-        new_page->cursor += len;
+void dymem_rewind(Dymem *mem, Dymem_Mark mark)
+{
+    Memory_Page *released_pages = NULL;
 
-        // Append new_page to list.
-        Memory_Page *last_page = page;
-        while (NULL != last_page->next) {
-            last_page = last_page->next;
-        }
-        last_page->next = new_page;
+    if (NULL == mark.page) {
+        released_pages = mem->first_page;
+        mem->first_page = NULL;
+        mem->page_cursor = NULL;
     } else {
-        // Data can fit in existing page.
-        mem_cursor = page->cursor;
-        page->used += len;
-        page->cursor += len;
+        released_pages = mark.page->next;
+        // The page will be written to again.
+        mem->spilled_bytes -= mark.page->paged_out_size;
+        mark.page->paged_out_size = 0;
+        mark.page->next = NULL;
+        mark.page->used = mark.used;
+        mark.page->cursor = mark.page->data + mark.used;
+        mem->page_cursor = mark.page;
     }
 
-    while (mem->page_cursor->used >= mem->page_cursor->size) {
-        // Used memory should never exceed page size.  If it has, a data
-        // corruption has occured and we must abort.
-        assert(mem->page_cursor->used == mem->page_cursor->size);
+    for (Memory_Page *page = released_pages; NULL != page; page = page->next) {
+        --mem->page_count;
+        mem->reserved_bytes -= page->size;
+        mem->mapped_bytes -= mem_page_mapped_size(page);
+        mem->spilled_bytes -= page->paged_out_size;
+    }
+    mem->requested_bytes = mark.requested_bytes;
+    mem->tail_waste_bytes = mark.tail_waste_bytes;
+    release_mempages(mem->page_pool, released_pages);
+}
 
-        mem->page_cursor = mem->page_cursor->next;
-        if (NULL == mem->page_cursor) { break; }
+// Move every page of src to the end of mem.  Data allocated from src keep
+// their addresses.  src is left empty.
+void dymem_append(Dymem *mem, Dymem *src)
+{
+    if (NULL == src->first_page) {
+        return;
+    }
+    if (NULL == mem->first_page) {
+        mem->first_page = src->first_page;
+    } else {
+        mem->page_cursor->next = src->first_page;
+        src->first_page->prev = mem->page_cursor;
+        mem->tail_waste_bytes += mem->page_cursor->size - mem->page_cursor->used;
     }
+    mem->page_cursor = src->page_cursor;
+    mem->page_count += src->page_count;
+    mem->requested_bytes += src->requested_bytes;
+    mem->reserved_bytes += src->reserved_bytes;
+    mem->mapped_bytes += src->mapped_bytes;
+    mem->tail_waste_bytes += src->tail_waste_bytes;
+    mem->spilled_bytes += src->spilled_bytes;
+    mem->peak_bytes = MAX(mem->peak_bytes, mem->reserved_bytes);
 
-    return mem_cursor;
+    src->first_page = NULL;
+    src->page_cursor = NULL;
+    src->page_count = 0;
+    src->requested_bytes = 0;
+    src->reserved_bytes = 0;
+    src->mapped_bytes = 0;
+    src->tail_waste_bytes = 0;
+    src->spilled_bytes = 0;
 }
 
-Dymem *dymem_init(size_t page_size)
+// Page out the data allocated so far.  Only the thread allocating from mem
+// may call this.
+void page_out_dymem(Dymem *mem)
+{
+    for (Memory_Page *page = mem->first_page; NULL != page; page = page->next) {
+        mem->spilled_bytes += page_out_mem_page(page);
+    }
+}
+
+Dymem *dymem_init_growing(Page_Pool *pool, size_t init_page_size, size_t max_page_size)
 {
     Dymem *mem = (Dymem *)malloc(sizeof(Dymem));
 
-    mem->init_page_size = page_size;
+    mem->init_page_size = init_page_size;
+    mem->max_page_size = max_page_size;
     mem->page_count = 0;
+    mem->requested_bytes = 0;
+    mem->reserved_bytes = 0;
+    mem->mapped_bytes = 0;
+    mem->tail_waste_bytes = 0;
+    mem->peak_bytes = 0;
+    mem->spilled_bytes = 0;
+    mem->page_pool = pool;
     mem->first_page = NULL;
     mem->page_cursor = NULL;
 
     return mem;
 }
 
+Dymem *dymem_init_in_page_pool(Page_Pool *pool, size_t page_size)
+{
+    return dymem_init_growing(pool, page_size, page_size);
+}
+
+Dymem *dymem_init(size_t page_size)
+{
+    return dymem_init_in_page_pool(NULL, page_size);
+}
+
 void dymem_free(Dymem *mem)
 {
-    free_mempages(mem->first_page);
+    release_mempages(mem->page_pool, mem->first_page);
     free(mem);
 }
-
@@ -0,0 +1,116 @@
+/* Event Loop
+ * ==========
+ *
+ *  The main loop waits in poll for any of three things to happen, and turns
+ *  each into events on the event queue:
+ *
+ *  - Keys on stdin, read by read_input_into_event_queue.
+ *  - A write to an eventfd, which background threads make with
+ *    wake_event_loop when they have news for the main thread, such as rows
+ *    loaded.  This becomes APP_EVENT_LOADER_PROGRESS.
+ *  - SIGCHLD, received through a signalfd, when a child process such as the
+ *    editor exits.  The child is reaped and APP_EVENT_EDITOR_EXIT is queued.
+ *
+ *  SIGCHLD is blocked in every thread, so that it is only ever delivered
+ *  through the signalfd.  init_event_loop must be called before any thread
+ *  is started, so that the threads inherit the blocked signal.
+ *
+ *  While the editor runs it owns the terminal, so stdin is not polled and
+ *  nothing is drawn, but background work is still taken in.
+ */
+
+Event_Loop global_event_loop = { .wake_fd = -1, .signal_fd = -1, .editor_pid = 0 };
+
+int init_event_loop(Event_Loop *loop)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL)) {
+        return errno;
+    }
+
+    loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    loop->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    loop->editor_pid = 0;
+    if (-1 == loop->wake_fd || -1 == loop->signal_fd) {
+        return errno;
+    }
+    return 0;
+}
+
+void close_event_loop(Event_Loop *loop)
+{
+    if (-1 != loop->wake_fd) close(loop->wake_fd);
+    if (-1 != loop->signal_fd) close(loop->signal_fd);
+    loop->wake_fd = -1;
+    loop->signal_fd = -1;
+}
+
+// Wake the main loop from another thread.  Wakes that come before the main
+// loop gets round to them are merged into one.
+void wake_event_loop(Event_Loop *loop)
+{
+    uint64_t one = 1;
+    if (-1 != loop->wake_fd) {
+        write(loop->wake_fd, &one, sizeof(one));
+    }
+}
+
+// Undo what the child inherited from the main loop, before it execs.
+void reset_event_loop_in_child()
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+}
+
+void reap_children_into_event_queue(Event_Loop *loop, Event_Queue *queue)
+{
+    struct signalfd_siginfo info;
+    while (sizeof(info) == read(loop->signal_fd, &info, sizeof(info)));
+
+    // Signals for several exits can arrive as one, so reap every child that
+    // has exited.
+    int status = 0;
+    pid_t pid = 0;
+    while (0 < (pid = waitpid(-1, &status, WNOHANG))) {
+        if (pid == loop->editor_pid) {
+            loop->editor_pid = 0;
+            push_event(queue, (Event){ APP_EVENT_EDITOR_EXIT, DYTYPE_INT, .data_as_int = status });
+        }
+    }
+}
+
+// Wait until something happens, and queue the events it leads to.
+void wait_for_events(Event_Loop *loop, Event_Queue *queue)
+{
+    int is_editor_running = 0 != loop->editor_pid;
+    struct pollfd fd_arr[] = {
+        { loop->wake_fd, POLLIN, 0 },
+        { loop->signal_fd, POLLIN, 0 },
+        // A negative fd is ignored by poll.
+        { is_editor_running? -1 : STDIN_FILENO, POLLIN, 0 },
+    };
+
+    if (-1 == poll(fd_arr, 3, -1)) {
+        // Interrupted, as by SIGWINCH, for which curses queues KEY_RESIZE.
+        if (EINTR == errno && !is_editor_running) {
+            read_input_into_event_queue(queue);
+        }
+        return;
+    }
+
+    if (fd_arr[0].revents & POLLIN) {
+        uint64_t wake_count = 0;
+        read(loop->wake_fd, &wake_count, sizeof(wake_count));
+        push_event(queue, plain_event(APP_EVENT_LOADER_PROGRESS));
+    }
+    if (fd_arr[1].revents & POLLIN) {
+        reap_children_into_event_queue(loop, queue);
+    }
+    if (fd_arr[2].revents & POLLIN) {
+        read_input_into_event_queue(queue);
+    }
+}
@@ -0,0 +1,144 @@
+/* Event Queue
+ * ===========
+ *
+ *  A ring buffer of the events waiting to be dispatched, so that every key
+ *  waiting to be read can be taken at once and handled as a batch, with the
+ *  screen drawn once at the end of the batch rather than once per key.  The
+ *  main loop also queues the events it receives from background work.  See
+ *  event-loop.c.
+ *
+ *  Keys are turned into events as they are queued.  A cursor movement that
+ *  follows one of the same kind is merged into it, so holding a key down on
+ *  a slow terminal moves the cursor by many rows in one step, and the cursor
+ *  stops when the key is released instead of working through a backlog.
+ *
+ *  Commands take vim style counts, so that 500j moves down 500 rows and 20G
+ *  goes to row 20.  gg goes to the first row, and G to the last.
+ */
+
+Event_Queue global_event_queue;
+
+int is_move_event(enum event_id id)
+{
+    return UI_EVENT_CURSOR_UP == id
+        || UI_EVENT_CURSOR_DOWN == id
+        || UI_EVENT_CURSOR_NEXT_COL == id
+        || UI_EVENT_CURSOR_PREV_COL == id;
+}
+
+// Add an event to the back of the queue, merging it into the last event if
+// they are movements of the same kind.  Returns 0 if the queue is full.
+int push_event(Event_Queue *queue, Event event)
+{
+    if (queue->count) {
+        Event *last = &queue->event_arr[(queue->head + queue->count - 1) & (EVENT_QUEUE_SIZE - 1)];
+        if (last->id == event.id && is_move_event(event.id)) {
+            last->data_as_int = MIN(last->data_as_int + event.data_as_int, EVENT_MAX_MOVE);
+            return 1;
+        }
+        if (last->id == event.id && UI_EVENT_CURSOR_GOTO_ROW == event.id) {
+            last->data_as_int = event.data_as_int;
+            return 1;
+        }
+    }
+    if (EVENT_QUEUE_SIZE == queue->count) {
+        return 0;
+    }
+    queue->event_arr[(queue->head + queue->count) & (EVENT_QUEUE_SIZE - 1)] = event;
+    ++queue->count;
+    return 1;
+}
+
+// Take the event at the front of the queue.  Returns 0 if it is empty.
+int pop_event(Event_Queue *queue, Event *event)
+{
+    if (!queue->count) {
+        return 0;
+    }
+    *event = queue->event_arr[queue->head];
+    queue->head = (queue->head + 1) & (EVENT_QUEUE_SIZE - 1);
+    --queue->count;
+    return 1;
+}
+
+// Turn a key into events on the queue.  Returns 0 if the key opens a prompt,
+// which reads the keys typed after it itself.
+int push_key_into_event_queue(Event_Queue *queue, int key)
+{
+    int count = queue->key_count;
+    int pending_key = queue->pending_key;
+    queue->key_count = 0;
+    queue->pending_key = 0;
+
+    if (key >= '0' && key <= '9' && (count || '0' != key)) {
+        queue->key_count = MIN(10 * count + key - '0', EVENT_MAX_MOVE);
+        queue->pending_key = pending_key;
+        return 1;
+    }
+    if ('g' == pending_key) {
+        if ('g' == key) {
+            push_event(queue, move_event(UI_EVENT_CURSOR_GOTO_ROW, count? count - 1 : 0));
+        }
+        return 1;
+    }
+
+    switch (key) {
+        case 'j':
+            push_event(queue, move_event(UI_EVENT_CURSOR_DOWN, count? count : 1));
+            break;
+
+        case 'k':
+            push_event(queue, move_event(UI_EVENT_CURSOR_UP, count? count : 1));
+            break;
+
+        case 'w':
+            push_event(queue, move_event(UI_EVENT_CURSOR_NEXT_COL, count? count : 1));
+            break;
+
+        case 'b':
+            push_event(queue, move_event(UI_EVENT_CURSOR_PREV_COL, count? count : 1));
+            break;
+
+        case 'g':
+            queue->pending_key = key;
+            queue->key_count = count;
+            break;
+
+        case 'G':
+            push_event(queue, move_event(UI_EVENT_CURSOR_GOTO_ROW, count? count - 1 : EVENT_LAST_ROW));
+            break;
+
+        case 'l':
+            push_event(queue, plain_event(UI_EVENT_CURSOR_RIGHT));
+            break;
+
+        case 'h':
+            push_event(queue, plain_event(UI_EVENT_CURSOR_LEFT));
+            break;
+
+        case ':':
+            push_event(queue, (Event){ UI_EVENT_KEY_PRESS, DYTYPE_CHAR, .data_as_char = key });
+            return 0;
+
+        default:
+            push_event(queue, (Event){ UI_EVENT_KEY_PRESS, DYTYPE_CHAR, .data_as_char = key });
+    }
+    return 1;
+}
+
+// Queue every key waiting to be read, up to a key that opens a prompt.
+// stdscr is in nodelay mode, so this never waits.  Returns 0 if there were
+// no keys.
+int read_input_into_event_queue(Event_Queue *queue)
+{
+    int key_count = 0;
+    int key = 0;
+
+    while (queue->count < EVENT_QUEUE_SIZE && ERR != (key = getch())) {
+        ++key_count;
+        if (!push_key_into_event_queue(queue, key)) {
+            break;
+        }
+    }
+    return key_count > 0;
+}
@@ -1,11 +1,128 @@
+Table_View *current_table_view_from_loaded_tables()
+{
+    Vector *vec = global_app_state.loaded_table_vec;
+    if (vec->len) {
+        return (Table_View *)vec_seek(vec, vec->len - 1);
+    }
+    return &global_app_state.user_tables;
+}
+
+Table_View *table_view_from_loaded_tables(Table *table)
+{
+    Vector_Iter *iter = new_vector_iter(global_app_state.loaded_table_vec);
+    Table_View *view = NULL;
+
+    vec_loop (iter, Table_View, view) {
+        if (table == view->table) {
+            delete_vector_iter(iter);
+            return view;
+        }
+    }
+
+    delete_vector_iter(iter);
+    return NULL;
+}
+
+// Load the table that the foreign key under the cursor refers to, so that
+// the rows it refers to can be shown alongside the key.
+void update_fk_lookup_for_table_view(Table_View *view)
+{
+    Table_Column *column = NULL;
+    if (view->cursor.col < view->table->col_count) {
+        column = (Table_Column *)vec_seek(view->table->column_vec, view->cursor.col);
+    }
+    Table *lookup_table = view->fk_lookup_table;
+
+    if (NULL != lookup_table) {
+        if (NULL != column
+        &&  NULL != column->fk_table_name
+        &&  0 == strcmp(column->fk_table_name, lookup_table->name)) {
+            return;
+        }
+        unref_table_from_table_pool(global_table_pool, lookup_table);
+        view->fk_lookup_table = NULL;
+    }
+    if (NULL != column && NULL != column->fk_table_name) {
+        if (!new_table_with_data_using_sqlite(&lookup_table, column->fk_table_name)) {
+            view->fk_lookup_table = lookup_table;
+        }
+    }
+}
+
+void pop_table_view()
+{
+    Table_View *view = global_app_state.current_table_view;
+    if (NULL != view->fk_lookup_table) {
+        unref_table_from_table_pool(global_table_pool, view->fk_lookup_table);
+    }
+    unref_table_from_table_pool(global_table_pool, view->table);
+    vec_pop(global_app_state.loaded_table_vec);
+    global_app_state.current_table_view = current_table_view_from_loaded_tables();
+}
+
+// Keep the loaded tables within the pool's memory budget.  The least
+// recently viewed tables that are not on the navigation path are released
+// first.  If the pool spills to disk, the tables are then paged out, and any
+// table still loading is paged out by its loader as it loads.  Otherwise,
+// the foreign key lookups of the views that are not shown are released, and
+// are loaded again when their view is returned to.  If the tables on the
+// path are still over budget, the tables loading in the background are
+// stopped, those of the views and lookups that are not shown first, until
+// the pool is within budget.
+void enforce_memory_budget()
+{
+    Table_Pool *pool = global_table_pool;
+    __atomic_store_n(&pool->is_paging_out, 0, __ATOMIC_RELAXED);
+    if (!table_pool_is_over_budget(pool)) {
+        return;
+    }
+    trim_table_pool(pool);
+    if (!table_pool_is_over_budget(pool)) {
+        return;
+    }
+    if (-1 != pool->page_pool.spill_fd) {
+        page_out_table_pool(pool);
+        __atomic_store_n(&pool->is_paging_out, table_pool_is_over_budget(pool), __ATOMIC_RELAXED);
+        return;
+    }
+
+    Vector_Iter *iter = new_vector_iter(global_app_state.loaded_table_vec);
+    Table_View *view = NULL;
+    vec_loop (iter, Table_View, view) {
+        if (view != global_app_state.current_table_view && NULL != view->fk_lookup_table) {
+            unref_table_from_table_pool(pool, view->fk_lookup_table);
+            view->fk_lookup_table = NULL;
+        }
+    } delete_vector_iter(iter);
+    trim_table_pool(pool);
+
+    Table *current_table = global_app_state.current_table_view->table;
+    Table *table = NULL;
+    iter = new_vector_iter(pool->table_vec);
+    vec_loop (iter, Table, table) {
+        if (table != current_table
+        &&  NULL != table->data_mem
+        &&  poll_table_loader(table)
+        &&  table_pool_is_over_budget(pool)) {
+            cancel_table_loader(table);
+            report_table_load_over_budget(pool, table);
+        }
+    } delete_vector_iter(iter);
+
+    if (poll_table_loader(current_table) && table_pool_is_over_budget(pool)) {
+        cancel_table_loader(current_table);
+        report_table_load_over_budget(pool, current_table);
+    }
+}
+
 void dispatch_app_event(Event event)
 {
-    endwin();
 start:
     switch (event.id) {
         case APP_EVENT_LOAD_USER_TABLES: {
             char sql[] = "select schema, name, type, ncol, wr, strict "
                           "from pragma_table_list;";
+            refresh_schema_catalog_using_sqlite(&global_schema_catalog, global_app_state.db);
             int err = new_table_with_query_using_sqlite(&global_app_state.user_tables.table, "Available tables", sql);
             //if (err) return; // TODO: Deal with this meaningfully.
             if (err) {
@@ -20,10 +137,73 @@ start:
         } break;
 
         case APP_EVENT_LOAD_TABLE: {
+            enforce_memory_budget();
             global_app_state.current_table_view = (Table_View *)vec_push_empty(global_app_state.loaded_table_vec);
             global_app_state.current_table_view->cursor = (View_Cursor){ 0, 0 };
+            global_app_state.current_table_view->fk_lookup_table = NULL;
             int err = new_table_with_data_using_sqlite(&global_app_state.current_table_view->table, event.data_as_text);
-            if (err) return; // TODO: Deal with this meaningfully.
+            if (err) { // TODO: Deal with this meaningfully.
+                vec_pop(global_app_state.loaded_table_vec);
+                global_app_state.current_table_view = current_table_view_from_loaded_tables();
+                return;
+            }
+
+            event = (Event){ APP_EVENT_VIEW_TABLE, DYTYPE_INT, .data_as_int = APP_VIEW_TABLE};
+            goto start;
+        } break;
+
+        case APP_EVENT_UNLOAD_TABLE: {
+            if (global_app_state.current_table_view == &global_app_state.user_tables) {
+                break;
+            }
+            pop_table_view();
+            trim_table_pool(global_table_pool);
+        } break;
+
+        case APP_EVENT_FOLLOW_FK: {
+            Table_View *view = global_app_state.current_table_view;
+            if (view->cursor.row >= loaded_row_count(view->table)) {
+                break;
+            }
+            Table_Column *column = (Table_Column *)vec_seek(view->table->column_vec, view->cursor.col);
+            Table_Cell *cell = (Table_Cell *)vec_seek(column->cell_vec, view->cursor.row);
+            if (NULL == column->fk_table_name || DYTYPE_NULL == cell->type) {
+                break;
+            }
+
+            Table *fk_table = NULL;
+            enforce_memory_budget();
+            int err = new_table_with_data_using_sqlite(&fk_table, column->fk_table_name);
+            if (err) { // TODO: Deal with this meaningfully.
+                break;
+            }
+            Table_Column *fk_column = fk_column_from_table(fk_table, column);
+            int fk_row = NULL == fk_column
+                ? -1
+                : row_from_column_index(fk_table, fk_column, column, cell);
+            if (fk_row < 0 && NULL != fk_column && NULL != fk_table->window) {
+                // The row may be outside the window loaded.
+                fk_row = seek_table_window_to_key_using_sqlite(fk_table, fk_column, column, cell);
+            }
+
+            // Following a cycle of foreign keys leads back to a table that
+            // is already open.  Return to its view rather than stacking
+            // another view of the same table.
+            Table_View *fk_view = table_view_from_loaded_tables(fk_table);
+            if (NULL != fk_view) {
+                unref_table_from_table_pool(global_table_pool, fk_table);
+                while (global_app_state.current_table_view != fk_view) {
+                    pop_table_view();
+                }
+                trim_table_pool(global_table_pool);
+            } else {
+                fk_view = (Table_View *)vec_push_empty(global_app_state.loaded_table_vec);
+                fk_view->table = fk_table;
+                fk_view->fk_lookup_table = NULL;
+                global_app_state.current_table_view = fk_view;
+            }
+            fk_view->cursor = (View_Cursor){ fk_row < 0? 0 : fk_row, 0 };
+            slide_table_window_to_cursor(fk_view->table, &fk_view->cursor);
 
             event = (Event){ APP_EVENT_VIEW_TABLE, DYTYPE_INT, .data_as_int = APP_VIEW_TABLE};
             goto start;
@@ -55,32 +235,164 @@ start:
         } break;
 
         case APP_EVENT_EDIT_FILE: {
+            if (global_event_loop.editor_pid) {
+                break;
+            }
+            // Hand the terminal to the editor.  The main loop keeps running
+            // without drawing or reading keys until APP_EVENT_EDITOR_EXIT.
+            def_prog_mode();
+            endwin();
             pid_t pid = fork();
 
             if (0 == pid) { // child
                 char *args[] = {"/usr/bin/vim", event.data_as_text, NULL};
+                reset_event_loop_in_child();
                 execvp(args[0], args);
+                _exit(127);
                 // TODO:
                 // - Parse results on file save
                 // - Identify fields without required data (inc. foreign records)
+            } else if (-1 == pid) {
+                reset_prog_mode();
+                invalidate_view();
             } else {        // parent
-                int status;
-                waitpid(pid, &status, 0);
-                printw("Child process finished\n");
+                global_event_loop.editor_pid = pid;
+            }
+        } break;
+
+        case APP_EVENT_EDITOR_EXIT:
+            reset_prog_mode();
+            invalidate_view();
+            break;
+
+        case APP_EVENT_LOADER_PROGRESS:
+            // More rows have loaded; they are shown when the view is drawn.
+            break;
+
+        case APP_EVENT_RUN_QUERY: {
+            Table *table = NULL;
+            enforce_memory_budget();
+            int err = new_table_with_console_query_using_sqlite(
+                    &table, event.data_as_text, global_app_state.query_row_limit,
+                    global_app_state.status_message, sizeof(global_app_state.status_message));
+            if (err) {
+                break;
+            }
+            Table_View *view = (Table_View *)vec_push_empty(global_app_state.loaded_table_vec);
+            view->cursor = (View_Cursor){ 0, 0 };
+            view->table = table;
+            view->fk_lookup_table = NULL;
+            global_app_state.current_table_view = view;
+
+            event = (Event){ APP_EVENT_VIEW_TABLE, DYTYPE_INT, .data_as_int = APP_VIEW_TABLE};
+            goto start;
+        } break;
+
+        case APP_EVENT_CANCEL_LOAD: {
+            cancel_table_loader_for_user(global_app_state.current_table_view->table,
+                    global_app_state.status_message, sizeof(global_app_state.status_message));
+        } break;
+
+        case APP_EVENT_EXPLAIN_QUERY_PLAN: {
+            Table *table = global_app_state.current_table_view->table;
+            char line_arr[QUERY_PLAN_MAX_STEPS][SESSION_LOG_LINE_LEN];
+            const char *line_ptr_arr[QUERY_PLAN_MAX_STEPS];
+            int line_count = -1;
+            if (NULL != table->sql) {
+                line_count = explain_query_plan_using_sqlite(
+                        global_app_state.db, table->sql, line_arr, QUERY_PLAN_MAX_STEPS);
+            }
+            if (line_count < 0) {
+                report_error("No query plan for %s.", table->name);
+                break;
             }
+            loop (line_idx, line_count) {
+                line_ptr_arr[line_idx] = line_arr[line_idx];
+            }
+            text_overlay_widget(table->sql, line_ptr_arr, line_count);
+            invalidate_view();
+        } break;
+
+        case APP_EVENT_SHOW_SESSION_LOG: {
+            const char *line_ptr_arr[SESSION_LOG_MAX_LINES];
+            int line_count = lines_from_session_log(&global_session_log, line_ptr_arr);
+            text_overlay_widget("Session log", line_ptr_arr, line_count);
+            invalidate_view();
         } break;
 
-        case APP_EVENT_REFRESH_VIEW: break;
+        case APP_EVENT_SHOW_MEMORY_STATS: {
+            char line_arr[MEMORY_STATS_MAX_LINES][SESSION_LOG_LINE_LEN];
+            const char *line_ptr_arr[MEMORY_STATS_MAX_LINES];
+            int line_count = memory_stats_lines_from_table_pool(
+                    global_table_pool, line_arr, MEMORY_STATS_MAX_LINES);
+            loop (line_idx, line_count) {
+                line_ptr_arr[line_idx] = line_arr[line_idx];
+            }
+            if (NULL != global_app_state.memory_dump_path) {
+                int err = dump_memory_stats(global_table_pool, global_app_state.memory_dump_path);
+                if (err) {
+                    report_error("Error writing %s: %s", global_app_state.memory_dump_path, strerror(err));
+                }
+            }
+            text_overlay_widget("Memory", line_ptr_arr, line_count);
+            invalidate_view();
+        } break;
+
+        case APP_EVENT_VIEW_VALUE: {
+            Table_View *view = global_app_state.current_table_view;
+            if (view->cursor.row >= loaded_row_count(view->table)) {
+                break;
+            }
+            Table_Column *column = (Table_Column *)vec_seek(view->table->column_vec, view->cursor.col);
+            Table_Cell *cell = (Table_Cell *)vec_seek(column->cell_vec, view->cursor.row);
+            Value_Reader reader;
+            int err = open_value_reader_using_sqlite(&reader, global_app_state.db, view->table, column, cell);
+            if (err) {
+                report_error("Error (%d) reading %s: %s", err, column->name, sqlite3_errmsg(global_app_state.db));
+                break;
+            }
+
+            char title[SESSION_LOG_LINE_LEN];
+            char size_text[32];
+            format_byte_count(size_text, sizeof(size_text), reader.size);
+            snprintf(title, sizeof(title), "%s (%s%s)", column->name, size_text, reader.is_binary? " BLOB" : "");
+            value_overlay_widget(title, &reader);
+            if (reader.err) {
+                report_error("Error (%d) reading %s: %s", reader.err, column->name, sqlite3_errmsg(global_app_state.db));
+            }
+            close_value_reader(&reader);
+            invalidate_view();
+        } break;
     }
+}
 
+void draw_current_view()
+{
     switch (global_app_state.current_view) {
 
         case APP_VIEW_TABLE: {
+            Table *table = global_app_state.current_table_view->table;
+            update_fk_lookup_for_table_view(global_app_state.current_table_view);
+            touch_table_in_table_pool(global_table_pool, table);
+            if (NULL != global_app_state.current_table_view->fk_lookup_table) {
+                touch_table_in_table_pool(global_table_pool, global_app_state.current_table_view->fk_lookup_table);
+            }
+            char status_bar_text[255] = "";
+            int is_loading = poll_table_loader(table);
+            if (is_loading) {
+                table_loader_progress_text(table, status_bar_text, sizeof(status_bar_text));
+            } else if (global_app_state.status_message[0]) {
+                strcpy(status_bar_text, global_app_state.status_message);
+            } else if (global_app_state.is_showing_load_stats && table->load_stats.is_done) {
+                load_stats_text(table, status_bar_text, sizeof(status_bar_text));
+            }
+
             View_Table_Model viewmodel = {
                 .cursor = &global_app_state.current_table_view->cursor,
-                .table = global_app_state.current_table_view->table,
+                .table = table,
+                .fk_lookup_table = global_app_state.current_table_view->fk_lookup_table,
+                .status_bar_text = status_bar_text,
             };
-            enable_curses();
             view_table(viewmodel);
         } break;
 
@@ -91,23 +403,41 @@ start:
 
 void dispatch_ui_event(Event event)
 {
-start:
+    Table_View *view = global_app_state.current_table_view;
+    global_app_state.status_message[0] = '\0';
+
     switch (event.id) {
         case UI_EVENT_KEY_PRESS:
             switch (event.data_as_char) {
-            case 'j':
-                event = plain_event(UI_EVENT_CURSOR_DOWN);
-                goto start;
+            case ':': {
+                char sql[1024] = "";
+                if (text_prompt_widget(":", sql, sizeof(sql))) {
+                    dispatch_app_event((Event){ APP_EVENT_RUN_QUERY, DYTYPE_TEXT, .data_as_text = sql });
+                }
+            } break;
+
+            case 3:  // Ctrl-C
+                dispatch_app_event(plain_event(APP_EVENT_CANCEL_LOAD));
+                break;
+
+            case 't':
+                global_app_state.is_showing_load_stats = !global_app_state.is_showing_load_stats;
+                break;
+
+            case 'x':
+                dispatch_app_event(plain_event(APP_EVENT_EXPLAIN_QUERY_PLAN));
+                break;
+
+            case 'L':
+                dispatch_app_event(plain_event(APP_EVENT_SHOW_SESSION_LOG));
                 break;
 
-            case 'k':
-                event = plain_event(UI_EVENT_CURSOR_UP);
-                goto start;
+            case 'M':
+                dispatch_app_event(plain_event(APP_EVENT_SHOW_MEMORY_STATS));
                 break;
 
-            case 'l':
-                event = plain_event(UI_EVENT_CURSOR_RIGHT);
-                goto start;
+            case 'v':
+                dispatch_app_event(plain_event(APP_EVENT_VIEW_VALUE));
                 break;
 
             case 'c':
@@ -125,38 +455,57 @@ start:
             break;
 
         case UI_EVENT_CURSOR_UP: {
-            if (global_app_state.current_table_view->cursor.row > 0) {
-                --global_app_state.current_table_view->cursor.row;
-            }
-            dispatch_app_event(plain_event(APP_EVENT_REFRESH_VIEW));
+            int row = table_row_from_cursor(view->table, &view->cursor);
+            seek_table_cursor_to_row(view->table, &view->cursor, row - event.data_as_int);
         } break;
 
         case UI_EVENT_CURSOR_DOWN: {
-            if (global_app_state.current_table_view->cursor.row
-                    < global_app_state.current_table_view->table->row_count -1) {
-                ++global_app_state.current_table_view->cursor.row;
-            }
-            dispatch_app_event(plain_event(APP_EVENT_REFRESH_VIEW));
+            int row = table_row_from_cursor(view->table, &view->cursor);
+            seek_table_cursor_to_row(view->table, &view->cursor, row + event.data_as_int);
         } break;
 
+        case UI_EVENT_CURSOR_GOTO_ROW:
+            seek_table_cursor_to_row(view->table, &view->cursor, event.data_as_int);
+            break;
+
+        case UI_EVENT_CURSOR_NEXT_COL:
+            view->cursor.col = MIN(view->cursor.col + event.data_as_int, view->table->col_count - 1);
+            break;
+
+        case UI_EVENT_CURSOR_PREV_COL:
+            view->cursor.col = MAX(view->cursor.col - event.data_as_int, 0);
+            break;
+
         case UI_EVENT_CURSOR_RIGHT: {
-            Table_Column *col
-                = (Table_Column *)
-                  vec_seek(global_app_state.current_table_view->table->column_vec, 1);
-
-            Table_Cell *cell
-                = (Table_Cell *)
-                  vec_seek(
-                          col->cell_vec,
-                          global_app_state.current_table_view->cursor.row
-                          );
+            if (view != &global_app_state.user_tables) {
+                dispatch_app_event(plain_event(APP_EVENT_FOLLOW_FK));
+                break;
+            }
+            if (view->cursor.row >= loaded_row_count(view->table)) {
+                break;
+            }
+            Table_Column *col = (Table_Column *)vec_seek(view->table->column_vec, 1);
+            Table_Cell *cell = (Table_Cell *)vec_seek(col->cell_vec, view->cursor.row);
             event = (Event){
                 APP_EVENT_LOAD_TABLE,
                 DYTYPE_TEXT,
-                .data_as_text = cell->str_data,
+                .data_as_text = (char *)str_from_table_cell(col, cell),
             };
             dispatch_app_event(event);
         } break;
 
+        case UI_EVENT_CURSOR_LEFT:
+            dispatch_app_event(plain_event(APP_EVENT_UNLOAD_TABLE));
+            break;
+
+    }
+}
+
+void dispatch_event(Event event)
+{
+    if (event.id < APP_EVENT_LOAD_USER_TABLES) {
+        dispatch_ui_event(event);
+    } else {
+        dispatch_app_event(event);
     }
 }
@@ -3,13 +3,26 @@ enum event_id {
     UI_EVENT_CURSOR_UP,
     UI_EVENT_CURSOR_DOWN,
     UI_EVENT_CURSOR_RIGHT,
+    UI_EVENT_CURSOR_LEFT,
+    UI_EVENT_CURSOR_NEXT_COL,
+    UI_EVENT_CURSOR_PREV_COL,
+    UI_EVENT_CURSOR_GOTO_ROW,
 
     APP_EVENT_LOAD_USER_TABLES,
     APP_EVENT_LOAD_TABLE,
+    APP_EVENT_UNLOAD_TABLE,
+    APP_EVENT_FOLLOW_FK,
     APP_EVENT_VIEW_TABLE,
-    APP_EVENT_REFRESH_VIEW,
     APP_EVENT_CREATE_RECORD,
     APP_EVENT_EDIT_FILE,
+    APP_EVENT_EDITOR_EXIT,
+    APP_EVENT_LOADER_PROGRESS,
+    APP_EVENT_RUN_QUERY,
+    APP_EVENT_CANCEL_LOAD,
+    APP_EVENT_EXPLAIN_QUERY_PLAN,
+    APP_EVENT_SHOW_SESSION_LOG,
+    APP_EVENT_SHOW_MEMORY_STATS,
+    APP_EVENT_VIEW_VALUE,
 };
 
 typedef struct Event {
@@ -25,3 +38,26 @@ typedef struct Event {
 } Event;
 
 #define plain_event(evt) (Event){ evt, DYTYPE_NULL, .data_as_null = NULL }
+
+// Cursor movements carry the number of rows or columns to move.
+#define move_event(evt, count) (Event){ evt, DYTYPE_INT, .data_as_int = (count) }
+
+#define EVENT_QUEUE_SIZE 64      // A power of 2.
+#define EVENT_MAX_MOVE 10000000  // Larger counts are cut to this.
+#define EVENT_LAST_ROW INT_MAX   // Row of UI_EVENT_CURSOR_GOTO_ROW for G.
+
+// Events read from the keyboard but not yet dispatched.  See event-queue.c.
+typedef struct event_queue {
+    Event event_arr[EVENT_QUEUE_SIZE];
+    unsigned int head;  // Position of the next event to dispatch.
+    unsigned int count;
+    int key_count;      // Count typed before a command, or 0.
+    int pending_key;    // First key of a two key command, or 0.
+} Event_Queue;
+
+// What the main loop waits on.  See event-loop.c.
+typedef struct event_loop {
+    int wake_fd;       // eventfd written by background threads.
+    int signal_fd;     // signalfd receiving SIGCHLD.
+    pid_t editor_pid;  // 0 unless the editor is running.
+} Event_Loop;
@@ -1,9 +1,25 @@
+#define _GNU_SOURCE  // For wcwidth.
+
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <limits.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <signal.h>
+#include <poll.h>
+#include <errno.h>
 #include <string.h>
+#include <ctype.h>
 #include <locale.h>
+#include <pthread.h>
+#include <time.h>
+#include <wchar.h>
 
 #include <ncurses.h>
 #include <sqlite3.h>
@@ -17,7 +33,17 @@
 
 #include "util.c"
 #include "memory.c"
+#include "event-queue.c"
+#include "event-loop.c"
+#include "load-stats.c"
+#include "memory-stats.c"
+#include "stmt-cache.c"
+#include "schema-catalog.c"
 #include "data-model.c"
+#include "column-dictionary.c"
+#include "column-index.c"
+#include "value-reader.c"
+#include "table-loader.c"
 #include "yaml.c"
 #include "widgets.c"
 #include "view.c"
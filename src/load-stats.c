@@ -0,0 +1,266 @@
+/* Load Stats
+ * ==========
+ *
+ *  Measures what loading a table costs, and keeps a log of the loads and
+ *  errors of the session.
+ *
+ *  A load is split into phases, each timed with the monotonic clock:
+ *
+ *  - prepare: preparing the statement and reading the table's metadata.
+ *  - step: SQLite finding the rows, in sqlite3_step.
+ *  - copy: copying each row into the table's cells.
+ *  - draw: the last time the table widget drew the table.
+ *
+ *  Rows are stepped and copied in a tight loop, so the loop does not read
+ *  the clock for every row.  Only the copy of one row in every
+ *  LOAD_TIMER_SAMPLE_INTERVAL is timed, and the copy time of the rest is
+ *  estimated from it.  The step time is the time the loop took, less the
+ *  copy time.  See Load_Timer.
+ *
+ *  The stats also count the bytes of data copied into cells, and the arena
+ *  pages that the table's columns hold once the load is done.  A parallel
+ *  scan adds up the step and copy times of all of its workers, so they can
+ *  add up to more than the time the load took.
+ *
+ *  Finished loads and SQLite errors are written to the session log, which
+ *  keeps the last SESSION_LOG_MAX_LINES lines, and also to a file if one is
+ *  given with -L.  Errors are also shown in the status bar.  The log must
+ *  only be written from the main thread.
+ */
+
+#define SESSION_LOG_MAX_LINES 256  // A power of 2.
+#define SESSION_LOG_LINE_LEN 200
+#define QUERY_PLAN_MAX_STEPS 64
+#define LOAD_TIMER_SAMPLE_INTERVAL 64
+
+typedef struct session_log {
+    char line_arr[SESSION_LOG_MAX_LINES][SESSION_LOG_LINE_LEN];  // A ring.
+    int line_count;    // Lines written in the session, including any lost.
+    int64_t start_ns;  // When the session started.
+    FILE *file;        // NULL unless the log is also written to a file.
+} Session_Log;
+
+Session_Log global_session_log;
+
+int64_t monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void log_session(const char *format, ...)
+{
+    Session_Log *log = &global_session_log;
+    char *line = log->line_arr[log->line_count & (SESSION_LOG_MAX_LINES - 1)];
+    int len = snprintf(line, SESSION_LOG_LINE_LEN, "[%8.3fs] ",
+                       (monotonic_ns() - log->start_ns) / 1e9);
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line + len, SESSION_LOG_LINE_LEN - len, format, args);
+    va_end(args);
+    ++log->line_count;
+
+    if (NULL != log->file) {
+        fprintf(log->file, "%s\n", line);
+        fflush(log->file);
+    }
+}
+
+// Log an error and show it in the status bar.
+void report_error(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(global_app_state.status_message, sizeof(global_app_state.status_message), format, args);
+    va_end(args);
+    log_session("%s", global_app_state.status_message);
+}
+
+// The lines of the log still kept, oldest first.  line_ptr_arr must have
+// room for SESSION_LOG_MAX_LINES pointers.  Returns the number of lines.
+int lines_from_session_log(Session_Log *log, const char **line_ptr_arr)
+{
+    int first_line = MAX(log->line_count - SESSION_LOG_MAX_LINES, 0);
+    loop_from (line_idx, first_line, log->line_count) {
+        line_ptr_arr[line_idx - first_line] = log->line_arr[line_idx & (SESSION_LOG_MAX_LINES - 1)];
+    }
+    return log->line_count - first_line;
+}
+
+// Times the rows of a load loop, by sampling.  Flushed into the load's
+// stats at the end of the loop, and by loaders at the end of each batch.
+typedef struct load_timer {
+    int64_t start_ns;        // When the rows since the last flush began.
+    int64_t copy_start_ns;   // When the copy of the sampled row began.
+    int64_t sample_copy_ns;  // Time taken to copy the sampled rows.
+    int sample_count;
+    int row_count;           // Rows since the last flush.
+} Load_Timer;
+
+void start_load_timer(Load_Timer *timer)
+{
+    *timer = (Load_Timer){ 0 };
+    timer->start_ns = monotonic_ns();
+}
+
+// Call before copying a row.  Returns 1 if the row is sampled.
+int begin_load_timer_row(Load_Timer *timer)
+{
+    if (timer->row_count++ % LOAD_TIMER_SAMPLE_INTERVAL) {
+        return 0;
+    }
+    timer->copy_start_ns = monotonic_ns();
+    return 1;
+}
+
+// Call after copying a row, with what begin_load_timer_row returned.
+void end_load_timer_row(Load_Timer *timer, int is_sampled)
+{
+    if (is_sampled) {
+        timer->sample_copy_ns += monotonic_ns() - timer->copy_start_ns;
+        ++timer->sample_count;
+    }
+}
+
+// Add the time of the rows since the last flush to stats, and start timing
+// the rows that follow.
+void flush_load_timer(Load_Timer *timer, Load_Stats *stats)
+{
+    int64_t now_ns = monotonic_ns();
+    int64_t elapsed_ns = now_ns - timer->start_ns;
+    int64_t copy_ns = timer->sample_count
+                    ? timer->sample_copy_ns * timer->row_count / timer->sample_count
+                    : 0;
+    copy_ns = MIN(copy_ns, elapsed_ns);
+
+    stats->copy_ns += copy_ns;
+    stats->step_ns += elapsed_ns - copy_ns;
+    *timer = (Load_Timer){ 0 };
+    timer->start_ns = now_ns;
+}
+
+// Start measuring a load that began at start_ns, and has been preparing
+// since.
+void begin_table_load_stats(Table *table, int64_t start_ns)
+{
+    int64_t render_ns = table->load_stats.render_ns;
+    table->load_stats = (Load_Stats){ 0 };
+    table->load_stats.start_ns = start_ns;
+    table->load_stats.prepare_ns = monotonic_ns() - start_ns;
+    table->load_stats.render_ns = render_ns;
+}
+
+// The bytes of a cell's data that were copied out of SQLite.
+size_t table_cell_data_size(Table_Cell *cell)
+{
+    switch (cell->type) {
+        case DYTYPE_INT:
+        case DYTYPE_FLOAT:
+            return sizeof(int64_t);
+        case DYTYPE_TEXT:
+            return cell->is_partial? cell->str_size + 1 : cell->raw_size;
+        case DYTYPE_BLOB:
+            return cell->is_partial? 0 : cell->raw_size;
+        default:
+            return 0;
+    }
+}
+
+int table_page_count(Table *table)
+{
+    Vector_Iter *iter = new_vector_iter(table->column_vec);
+    Table_Column *column = NULL;
+    int page_count = 0;
+
+    vec_loop (iter, Table_Column, column) {
+        page_count += column->cell_vec->page_count
+                    + column->dymem_str_data->page_count
+                    + column->dymem_bin_data->page_count
+                    + column->dymem_view_data->page_count;
+    } delete_vector_iter(iter);
+
+    return page_count;
+}
+
+void format_byte_count(char *buf, size_t len, size_t byte_count)
+{
+    if (byte_count >= MB(1)) {
+        snprintf(buf, len, "%.1f MB", byte_count / 1e6);
+    } else if (byte_count >= KB(1)) {
+        snprintf(buf, len, "%.1f KB", byte_count / 1e3);
+    } else {
+        snprintf(buf, len, "%zu B", byte_count);
+    }
+}
+
+void load_stats_text(Table *table, char *buf, size_t len)
+{
+    Load_Stats *stats = &table->load_stats;
+    char bytes_text[32];
+    double load_s = (stats->step_ns + stats->copy_ns) / 1e9;
+    double rows_per_s = load_s > 0? stats->row_count / load_s : 0;
+
+    // The totals come first, as the status bar may cut the text short.
+    format_byte_count(bytes_text, sizeof(bytes_text), stats->bytes_copied);
+    snprintf(buf, len, "%d rows in %.1fms, %.0f%s rows/s, %s, %d pages (prepare %.1f, step %.1f, copy %.1f, draw %.1fms)",
+             stats->row_count, stats->elapsed_ns / 1e6,
+             rows_per_s >= 1e3? rows_per_s / 1e3 : rows_per_s, rows_per_s >= 1e3? "k" : "",
+             bytes_text, stats->page_count,
+             stats->prepare_ns / 1e6, stats->step_ns / 1e6,
+             stats->copy_ns / 1e6, stats->render_ns / 1e6);
+}
+
+// Finish measuring a load, and log it.
+void finish_table_load_stats(Table *table)
+{
+    Load_Stats *stats = &table->load_stats;
+    char stats_text[SESSION_LOG_LINE_LEN];
+
+    stats->elapsed_ns = monotonic_ns() - stats->start_ns;
+    stats->row_count = table->row_count;
+    stats->page_count = table_page_count(table);
+    stats->is_done = 1;
+
+    load_stats_text(table, stats_text, sizeof(stats_text));
+    log_session("%s: %s", table->name, stats_text);
+}
+
+// Write the query plan of sql to line_arr, a line for each step of the plan,
+// indented by its depth in the plan.  Returns the number of lines, or -1 if
+// the plan cannot be read.
+int explain_query_plan_using_sqlite(sqlite3 *db, const char *sql, char (*line_arr)[SESSION_LOG_LINE_LEN], int max_lines)
+{
+    char explain_sql[1100];
+    sqlite3_stmt *stmt = NULL;
+    int id_arr[QUERY_PLAN_MAX_STEPS];
+    int depth_arr[QUERY_PLAN_MAX_STEPS];
+    int step_count = 0;
+    int line_count = 0;
+
+    snprintf(explain_sql, sizeof(explain_sql), "explain query plan %s", sql);
+    if (sqlite3_prepare_v2(db, explain_sql, -1, &stmt, NULL)) {
+        return -1;
+    }
+    // Each step of the plan comes after its parent.
+    while (SQLITE_ROW == sqlite3_step(stmt) && line_count < max_lines) {
+        int id = sqlite3_column_int(stmt, 0);
+        int parent = sqlite3_column_int(stmt, 1);
+        int depth = 0;
+        loop (step_idx, step_count) {
+            if (parent == id_arr[step_idx]) {
+                depth = depth_arr[step_idx] + 1;
+            }
+        }
+        if (step_count < QUERY_PLAN_MAX_STEPS) {
+            id_arr[step_count] = id;
+            depth_arr[step_count] = depth;
+            ++step_count;
+        }
+        snprintf(line_arr[line_count++], SESSION_LOG_LINE_LEN, "%*s%s",
+                 2 * depth, "", (const char *)sqlite3_column_text(stmt, 3));
+    }
+    sqlite3_finalize(stmt);
+    return line_count;
+}
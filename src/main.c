@@ -3,6 +3,15 @@
 int shut_down(sqlite3 *db)
 {
     int err = 0;
+    clear_schema_catalog(&global_schema_catalog);
+    clear_stmt_cache(&global_stmt_cache);
+    close_event_loop(&global_event_loop);
+    if (NULL != global_app_state.memory_dump_path && NULL != global_table_pool) {
+        dump_memory_stats(global_table_pool, global_app_state.memory_dump_path);
+    }
+    if (NULL != global_session_log.file) {
+        fclose(global_session_log.file);
+    }
     printf("Closing database connection...");
     if (err = sqlite3_close_v2(db)) {
         fprintf(stderr, "failed:\n  %s\n", sqlite3_errmsg(db));
@@ -29,17 +38,81 @@ int main(int argc, char **argv)
     global_app_state.loaded_table_vec = new_vector(sizeof(Table_View), 20);
 
     global_app_state.current_table_view = &global_app_state.user_tables;
+    global_app_state.scan_worker_count = 0;
+    global_app_state.query_row_limit = 0;
+    global_app_state.status_message[0] = '\0';
+    global_app_state.is_showing_load_stats = 0;
+    global_app_state.memory_dump_path = NULL;
+    global_session_log.start_ns = monotonic_ns();
 
     sqlite3 *db = NULL;
     int err = 0;
+    int opt = 0;
+    size_t memory_budget = 0;
+    const char *spill_dir = NULL;
+
+    // -j <n>: Load tables in full, scanning them with n threads, instead
+    //         of loading them a window at a time.
+    // -l <n>: Load at most n rows of a query typed at the console.
+    // -L <file>: Append the session log to file.
+    // -m <n>: Keep the loaded tables within n MB, releasing the least
+    //         recently viewed tables that are not open.
+    // -s <dir>: Back the memory of loaded tables with a temporary file in
+    //           dir, so that tables larger than memory can be loaded.  With
+    //           -m, tables are paged out to the file to stay in budget.
+    // -M <file>: Write the memory used by each table to file, on exit and
+    //            whenever the memory overlay is shown.
+    while (-1 != (opt = getopt(argc, argv, "j:l:L:m:s:M:"))) {
+        switch (opt) {
+            case 'j':
+                global_app_state.scan_worker_count = atoi(optarg);
+                break;
+            case 'l':
+                global_app_state.query_row_limit = atoi(optarg);
+                break;
+            case 'L':
+                global_session_log.file = fopen(optarg, "a");
+                if (NULL == global_session_log.file) {
+                    fprintf(stderr, "Error opening %s: %s\n", optarg, strerror(errno));
+                    goto exit;
+                }
+                break;
+            case 'm':
+                memory_budget = MB((size_t)atoi(optarg));
+                break;
+            case 's':
+                spill_dir = optarg;
+                break;
+            case 'M':
+                global_app_state.memory_dump_path = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-j threads] [-l rows] [-L log file] [-m budget MB] [-s spill dir] [-M memory file] database\n", argv[0]);
+                goto exit;
+        }
+    }
+
+    err = init_event_loop(&global_event_loop);
+    if (err) {
+        fprintf(stderr, "Error starting the event loop: %s\n", strerror(err));
+        goto exit;
+    }
 
     global_table_pool = (Table_Pool *)malloc(sizeof(Table_Pool));
     init_table_pool(global_table_pool);
+    global_table_pool->max_bytes = memory_budget;
+    if (NULL != spill_dir) {
+        err = open_page_pool_spill_file(&global_table_pool->page_pool, spill_dir);
+        if (err) {
+            fprintf(stderr, "Error creating a spill file in %s: %s\n", spill_dir, strerror(err));
+            goto exit;
+        }
+    }
 
-    if (argc > 1) {
-        err = sqlite3_open_v2(argv[1], &db, SQLITE_OPEN_READONLY, 0);
+    if (argc > optind) {
+        err = sqlite3_open_v2(argv[optind], &db, SQLITE_OPEN_READONLY, 0);
         if (err) {
-            fprintf(stderr, "Error opening %s: %s\n", argv[1], sqlite3_errmsg(db));
+            fprintf(stderr, "Error opening %s: %s\n", argv[optind], sqlite3_errmsg(db));
             goto exit;
         }
     } else {
@@ -53,10 +126,16 @@ int main(int argc, char **argv)
     Event event = (Event){ APP_EVENT_LOAD_USER_TABLES, DYTYPE_NULL, .data_as_null = NULL };
     dispatch_app_event(event);
 
-    char input_ch;
-    while (input_ch = getch()) {
-        event = (Event){ UI_EVENT_KEY_PRESS, DYTYPE_CHAR, .data_as_char = input_ch };
-        dispatch_ui_event(event);
+    // Draw once for each batch of events, however many it holds.
+    for (;;) {
+        if (!global_event_loop.editor_pid) {
+            draw_current_view();
+        }
+        wait_for_events(&global_event_loop, &global_event_queue);
+        while (pop_event(&global_event_queue, &event)) {
+            dispatch_event(event);
+        }
+        enforce_memory_budget();
     }
 
 exit:
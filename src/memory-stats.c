@@ -0,0 +1,226 @@
+/* Memory Stats
+ * ============
+ *
+ *  Adds up the counters of the Dymems and Vectors that hold a table, and of
+ *  every table in a pool, to show how much memory the loaded tables take and
+ *  how much of it is wasted.  See memory.c for what each counter measures.
+ *
+ *  A table's memory includes its cells, their text and blobs, the text
+ *  formatted for display, its column indexes and dictionaries, and its
+ *  window's row keys.  Column indexes and dictionaries are allocated with
+ *  malloc, and count as blocks with no waste.
+ *
+ *  The stats can be shown in an overlay, or written to a file as tab
+ *  separated values, a line for each table, for use by scripts.  Byte counts
+ *  in the file are exact.  The counters of a table that is still loading
+ *  are read while the loader writes them, so may be slightly out of date.
+ *
+ *  The bytes mapped are what the pages take from the system: their headers,
+ *  and their sizes rounded up to whole system pages, or whole huge pages
+ *  for the largest.
+ *
+ *  Data that have been paged out to the spill file count as spilled, but are
+ *  still counted in the bytes held.  The memory a pool takes is the bytes
+ *  written to, less the bytes spilled; see memory_in_use.
+ */
+
+#define MEMORY_STATS_MAX_LINES 64
+#define MEMORY_STATS_LINE_FORMAT "%-14.14s "
+
+void add_dymem_to_memory_stats(Memory_Stats *stats, Dymem *mem)
+{
+    stats->page_count += mem->page_count;
+    stats->requested_bytes += mem->requested_bytes;
+    stats->reserved_bytes += mem->reserved_bytes;
+    stats->mapped_bytes += mem->mapped_bytes;
+    stats->tail_waste_bytes += mem->tail_waste_bytes;
+    stats->peak_bytes += mem->peak_bytes;
+    stats->spilled_bytes += mem->spilled_bytes;
+}
+
+void add_vector_to_memory_stats(Memory_Stats *stats, Vector *vec)
+{
+    stats->page_count += vec->page_count;
+    stats->requested_bytes += vec->len * vec->el_size;
+    stats->reserved_bytes += vec->reserved_bytes;
+    stats->mapped_bytes += vec->mapped_bytes;
+    stats->peak_bytes += vec->peak_bytes;
+    stats->spilled_bytes += vec->spilled_bytes;
+}
+
+void add_memory_stats(Memory_Stats *stats, Memory_Stats *other)
+{
+    stats->page_count += other->page_count;
+    stats->requested_bytes += other->requested_bytes;
+    stats->reserved_bytes += other->reserved_bytes;
+    stats->mapped_bytes += other->mapped_bytes;
+    stats->tail_waste_bytes += other->tail_waste_bytes;
+    stats->peak_bytes += other->peak_bytes;
+    stats->spilled_bytes += other->spilled_bytes;
+}
+
+void add_block_to_memory_stats(Memory_Stats *stats, size_t size)
+{
+    stats->requested_bytes += size;
+    stats->reserved_bytes += size;
+    stats->mapped_bytes += size;
+    stats->peak_bytes += size;
+}
+
+void add_table_column_to_memory_stats(Memory_Stats *stats, Table_Column *column)
+{
+    add_vector_to_memory_stats(stats, column->cell_vec);
+    add_dymem_to_memory_stats(stats, column->dymem_str_data);
+    add_dymem_to_memory_stats(stats, column->dymem_bin_data);
+    add_dymem_to_memory_stats(stats, column->dymem_view_data);
+    if (NULL != column->index) {
+        add_block_to_memory_stats(stats, column->index->slot_count * sizeof(int));
+    }
+    add_block_to_memory_stats(stats, column->dictionary.entry_capacity * sizeof(Dictionary_Entry)
+                                   + column->dictionary.slot_count * sizeof(int));
+}
+
+Memory_Stats memory_stats_from_table(Table *table)
+{
+    Memory_Stats stats = { 0 };
+    Vector_Iter *iter = new_vector_iter(table->column_vec);
+    Table_Column *column = NULL;
+
+    add_dymem_to_memory_stats(&stats, table->data_mem->dymem_meta_data);
+    add_vector_to_memory_stats(&stats, table->column_vec);
+    vec_loop (iter, Table_Column, column) {
+        add_table_column_to_memory_stats(&stats, column);
+    } delete_vector_iter(iter);
+
+    if (NULL != table->window) {
+        add_vector_to_memory_stats(&stats, table->window->row_key_vec);
+    }
+    return stats;
+}
+
+// The memory of every table in the pool, and of the pool's table slots.
+// Pages kept free for reuse are not included; see Page_Pool.free_bytes.
+Memory_Stats memory_stats_from_table_pool(Table_Pool *pool)
+{
+    Memory_Stats stats = { 0 };
+    Vector_Iter *iter = new_vector_iter(pool->table_vec);
+    Table *table = NULL;
+
+    add_vector_to_memory_stats(&stats, pool->table_vec);
+    vec_loop (iter, Table, table) {
+        if (NULL != table->data_mem) {
+            Memory_Stats table_stats = memory_stats_from_table(table);
+            add_memory_stats(&stats, &table_stats);
+        }
+    } delete_vector_iter(iter);
+
+    return stats;
+}
+
+// The bytes written to that are not paged out to a spill file.  The rest of
+// the pages held is never touched, so takes no memory unless the page was
+// allocated with malloc.  Spilled data that are read again come back into
+// memory, but the kernel may drop them again at any time, as they are
+// already on disk.
+size_t memory_in_use(Memory_Stats *stats)
+{
+    size_t written_bytes = stats->requested_bytes + stats->tail_waste_bytes;
+    return written_bytes > stats->spilled_bytes? written_bytes - stats->spilled_bytes : 0;
+}
+
+void memory_stats_text(const char *name, Memory_Stats *stats, char *buf, size_t len)
+{
+    char reserved_text[32];
+    char mapped_text[32];
+    char used_text[32];
+    char waste_text[32];
+    char peak_text[32];
+    char spilled_text[32];
+
+    format_byte_count(reserved_text, sizeof(reserved_text), stats->reserved_bytes);
+    format_byte_count(mapped_text, sizeof(mapped_text), stats->mapped_bytes);
+    format_byte_count(used_text, sizeof(used_text), stats->requested_bytes);
+    format_byte_count(waste_text, sizeof(waste_text), stats->tail_waste_bytes);
+    format_byte_count(peak_text, sizeof(peak_text), stats->peak_bytes);
+    format_byte_count(spilled_text, sizeof(spilled_text), stats->spilled_bytes);
+    snprintf(buf, len, MEMORY_STATS_LINE_FORMAT "%5d %8s %8s %8s %8s %8s %8s",
+             name, stats->page_count, reserved_text, mapped_text, used_text, waste_text, peak_text, spilled_text);
+}
+
+// Write a header, a line for each table in the pool, and the totals to
+// line_arr.  Returns the number of lines.
+int memory_stats_lines_from_table_pool(Table_Pool *pool, char (*line_arr)[SESSION_LOG_LINE_LEN], int max_lines)
+{
+    Vector_Iter *iter = new_vector_iter(pool->table_vec);
+    Table *table = NULL;
+    int line_count = 0;
+    char free_text[32];
+
+    snprintf(line_arr[line_count++], SESSION_LOG_LINE_LEN, MEMORY_STATS_LINE_FORMAT "%5s %8s %8s %8s %8s %8s %8s",
+             "Table", "Pages", "Held", "Mapped", "Used", "Waste", "Peak", "Spilled");
+    vec_loop (iter, Table, table) {
+        if (NULL != table->data_mem && line_count < max_lines - 2) {
+            Memory_Stats stats = memory_stats_from_table(table);
+            memory_stats_text(table->name, &stats, line_arr[line_count++], SESSION_LOG_LINE_LEN);
+        }
+    } delete_vector_iter(iter);
+
+    Memory_Stats total = memory_stats_from_table_pool(pool);
+    memory_stats_text("Total", &total, line_arr[line_count++], SESSION_LOG_LINE_LEN);
+
+    format_byte_count(free_text, sizeof(free_text), pool->page_pool.free_bytes);
+    snprintf(line_arr[line_count++], SESSION_LOG_LINE_LEN, MEMORY_STATS_LINE_FORMAT "%5d %8s",
+             "Free", pool->page_pool.free_page_count, free_text);
+    return line_count;
+}
+
+void write_memory_stats_line(FILE *file, const char *name, int ref_count, int row_count, Memory_Stats *stats)
+{
+    // Names may be SQL typed at the console, which must stay on one line.
+    for (const char *c = name; *c; ++c) {
+        fputc('\t' == *c || '\n' == *c || '\r' == *c? ' ' : *c, file);
+    }
+    fprintf(file, "\t%d\t%d\t%d\t%zu\t%zu\t%zu\t%zu\t%zu\t%zu\n",
+            ref_count, row_count, stats->page_count, stats->requested_bytes,
+            stats->reserved_bytes, stats->tail_waste_bytes, stats->peak_bytes,
+            stats->spilled_bytes, stats->mapped_bytes);
+}
+
+// Write the memory of every table in the pool, and the totals, to file as
+// tab separated values with a header.  The totals are on the line named
+// "*total*", and the pages kept free for reuse on the line named "*free*".
+void write_memory_stats(Table_Pool *pool, FILE *file)
+{
+    Vector_Iter *iter = new_vector_iter(pool->table_vec);
+    Table *table = NULL;
+
+    fprintf(file, "table\trefs\trows\tpages\trequested_bytes\treserved_bytes\ttail_waste_bytes\tpeak_bytes\tspilled_bytes\tmapped_bytes\n");
+    vec_loop (iter, Table, table) {
+        if (NULL != table->data_mem) {
+            Memory_Stats stats = memory_stats_from_table(table);
+            write_memory_stats_line(file, table->name, table->ref_count, table->row_count, &stats);
+        }
+    } delete_vector_iter(iter);
+
+    Memory_Stats total = memory_stats_from_table_pool(pool);
+    write_memory_stats_line(file, "*total*", 0, 0, &total);
+
+    Memory_Stats free_stats = {
+        .page_count = pool->page_pool.free_page_count,
+        .reserved_bytes = pool->page_pool.free_bytes,
+    };
+    write_memory_stats_line(file, "*free*", 0, 0, &free_stats);
+}
+
+// Write the memory stats to the file at path, replacing what it held.
+// Returns 0, or errno if the file cannot be written.
+int dump_memory_stats(Table_Pool *pool, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (NULL == file) {
+        return errno;
+    }
+    write_memory_stats(pool, file);
+    fclose(file);
+    return 0;
+}
@@ -10,28 +10,70 @@
  * to straddle page boundaries, as their references may not be
  * contiguous.
  *
- * Individual pages cannot be freed; instead, the entire page set
- * must be freed at once.
+ * Each page's header is stored inline, directly before its data, so a
+ * page takes a single allocation.  The data of every page start on a
+ * max_align_t boundary.  Small pages are allocated with malloc.  Larger
+ * pages are anonymous mmaps, which are returned to the system when the
+ * page is released.  Pages of HUGE_PAGE_SIZE or more are backed by huge
+ * pages where the system allows it, to cut TLB misses when scanning
+ * large tables.  Their mappings are a whole number of huge pages, so the
+ * header of such a page is allocated apart from its data, or a page of
+ * exactly HUGE_PAGE_SIZE would take two.
+ *
+ * Pages may be taken from, and released to, a Page_Pool.  The pool
+ * keeps a free list of pages that can be shared between any number of
+ * Dymems and Vectors, so memory released by one can be reused by
+ * another without going back to the system allocator.  Only pages of
+ * the exact size requested are reused.  Once the pool holds
+ * max_free_bytes, further released pages are freed.  A pool may be
+ * used from more than one thread.
+ *
+ * A pool may spill to disk.  Its large pages are then mapped from a
+ * temporary file, which is unlinked as soon as it is created, rather
+ * than from anonymous memory.  The kernel can write such pages to the
+ * file and drop them when memory runs short, and reads them back when
+ * they are next touched, so the data held can be larger than memory.
+ * page_out_mem_page writes the data of a page up to its cursor out and
+ * drops them straight away.  Dymems and Vectors only ever write past the
+ * cursor of their last page, so the data before it can be paged out as
+ * they grow.  Spilled pages are never huge pages.
+ * The disk space of a spilled page is given back when it is released.
  *
  * Dymem
  * -----
  *
- * Once initialised, Dymem can only ever grow or be freed entirely.
- * It cannot be shrunk or defragmented.
+ * Once initialised, Dymem can grow, be rewound to a mark, or be
+ * freed entirely.  It cannot be defragmented.
+ *
+ * dymem_mark records the current end of the allocated memory.
+ * dymem_rewind releases everything allocated after that mark, giving
+ * any pages that are no longer used back to the page pool.
  *
  * Dymem is initialised once, with no pages.
  *
  * The first page is allocated when memory is required.  The page
  * size will be set to the value of init_page_size unless the
  * amount of memory required exceeds this amount, in which case
- * the page size will be set to the required amount.
+ * the page size will be set to the required amount.  A Dymem
+ * created with dymem_init_growing doubles the size of each new
+ * page, up to max_page_size, so that small data sets stay small
+ * while large ones need few pages.
  *
  * Memory must be allocated through the dymem_allocate fn.
  * It can be allocated to any data type and must be cast
- * on assignment.
+ * on assignment.  dymem_allocate does not align the memory it
+ * returns; dymem_allocate_aligned must be used for data that need
+ * alignment, such as ints and doubles.
  *
- * dymem_allocate will attempt to fully fill a page before advancing
- * the page cursor to the next available page.
+ * dymem_allocate fills the last page until a request does not fit
+ * in it, then starts a new page.  The tail of the old page is not
+ * used again.
+ *
+ * Each Dymem counts the bytes requested from it, the bytes it holds in
+ * pages, the tails of the pages it has moved past, and the most it has
+ * held at once, so that page sizes can be chosen from real data.  The
+ * difference between the bytes held and the rest is alignment padding
+ * and the free end of the last page.  See memory-stats.c.
  *
  * Vector
  * ------
@@ -41,35 +83,340 @@
  *
  *  Unlike dymem, its first page is initialised when the vector is
  *  created, ready to receive data that are pushed to it.
+ *
+ *  A vector keeps a directory of its pages, so any element can be found
+ *  without walking the page list.  By default every page holds the same
+ *  number of elements.  A geometric vector doubles the size of each new
+ *  page, which keeps the page count low for vectors that grow very large.
+ *
+ *  The page directory of a geometric vector is allocated at its full size
+ *  when the vector is created, so it never moves.  One thread may push to a
+ *  geometric vector while others read the elements it has already pushed,
+ *  provided the writer publishes its progress (see table-loader.c).
+ *
+ *  A vector counts the bytes it holds in pages, and the most it has held
+ *  at once.  The bytes in use are its length times its element size.
  */
 
+#define MEM_PAGE_MMAP_THRESHOLD (64 * 1024)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+#define align_up(x, align) (((x) + (align) - 1) & ~((size_t)(align) - 1))
+#define align_down(x, align) ((x) & ~((size_t)(align) - 1))
+
+// Size of the page header, padded so that the data that follow it are
+// aligned for any type.
+#define MEM_PAGE_HEADER_SIZE align_up(sizeof(Memory_Page), _Alignof(max_align_t))
+
+size_t system_page_size()
+{
+    static size_t page_size = 0;
+    if (!page_size) {
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+    }
+    return page_size;
+}
+
+// Map len bytes, starting on a boundary of align bytes.
+void *map_aligned_memory(size_t len, size_t align)
+{
+    char *map = mmap(NULL, len + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == map) {
+        return NULL;
+    }
+
+    // Trim the unaligned head and the unused tail.
+    char *aligned = (char *)align_up((uintptr_t)map, align);
+    if (aligned > map) {
+        munmap(map, aligned - map);
+    }
+    munmap(aligned + len, (map + align) - aligned);
+
+    return aligned;
+}
+
+void *map_mem_page(size_t map_size)
+{
+    static int is_hugetlb_available = 1;
+    void *map = NULL;
+
+    if (map_size < HUGE_PAGE_SIZE) {
+        map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return MAP_FAILED == map? NULL : map;
+    }
+
+    // Explicit huge pages are only available if the system has reserved
+    // them.  Stop trying once a request has failed.
+    if (is_hugetlb_available) {
+        map = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (MAP_FAILED != map) {
+            return map;
+        }
+        is_hugetlb_available = 0;
+    }
+
+    // Otherwise, ask for transparent huge pages.  These require the
+    // mapping to be aligned to the huge page size.
+    map = map_aligned_memory(map_size, HUGE_PAGE_SIZE);
+    if (NULL != map) {
+        madvise(map, map_size, MADV_HUGEPAGE);
+    }
+    return map;
+}
+
 Memory_Page *new_mem_page(size_t page_size)
 {
-    Memory_Page *page = (Memory_Page *)malloc(sizeof(Memory_Page));
+    Memory_Page *page = NULL;
+    char *data = NULL;
+    size_t alloc_size = MEM_PAGE_HEADER_SIZE + page_size;
+    size_t map_size = 0;
+
+    if (alloc_size < MEM_PAGE_MMAP_THRESHOLD) {
+        page = (Memory_Page *)malloc(alloc_size);
+    } else if (alloc_size < HUGE_PAGE_SIZE) {
+        map_size = align_up(alloc_size, system_page_size());
+        page = (Memory_Page *)map_mem_page(map_size);
+    } else {
+        map_size = align_up(page_size, HUGE_PAGE_SIZE);
+        data = (char *)map_mem_page(map_size);
+        if (NULL != data) {
+            page = (Memory_Page *)malloc(MEM_PAGE_HEADER_SIZE);
+        }
+    }
+    if (NULL == page) {
+        fprintf(stderr, "Failed to allocate memory page of %zu bytes\n", page_size);
+        exit(1);
+    }
+
+    page->size = page_size;
+    page->used = 0;
+    page->map_size = map_size;
+    page->spill_offset = -1;
+    page->paged_out_size = 0;
+    page->cursor = page->data = NULL != data? data : (char *)page + MEM_PAGE_HEADER_SIZE;
+    page->next = NULL;
+    page->prev = NULL;
+    return page;
+}
+
+// Open an unlinked temporary file in dir to back the large pages of pool.
+// Returns 0, or errno if the file cannot be created.
+int open_page_pool_spill_file(Page_Pool *pool, const char *dir)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/spill-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (-1 == fd) {
+        return errno;
+    }
+    unlink(path);
+    pool->spill_fd = fd;
+    pool->spill_size = 0;
+    return 0;
+}
+
+// Map a page from the end of the pool's spill file.  Falls back to memory
+// if the file cannot grow, as when the disk is full.
+Memory_Page *new_spill_page(Page_Pool *pool, size_t page_size)
+{
+    size_t map_size = align_up(MEM_PAGE_HEADER_SIZE + page_size, system_page_size());
+
+    pthread_mutex_lock(&pool->lock);
+    off_t offset = pool->spill_size;
+    int err = ftruncate(pool->spill_fd, offset + map_size);
+    if (!err) {
+        pool->spill_size = offset + map_size;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    Memory_Page *page = err? MAP_FAILED : (Memory_Page *)mmap(
+            NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, pool->spill_fd, offset);
+    if (MAP_FAILED == page) {
+        return new_mem_page(page_size);
+    }
+
     page->size = page_size;
     page->used = 0;
-    page->cursor = page->data = (char *)malloc(page->size);
+    page->map_size = map_size;
+    page->spill_offset = offset;
+    page->paged_out_size = 0;
+    page->cursor = page->data = (char *)page + MEM_PAGE_HEADER_SIZE;
     page->next = NULL;
     page->prev = NULL;
     return page;
 }
 
+// Set if the header of a page is allocated apart from its data, as for
+// huge pages.
+#define mem_page_has_own_header(page) ((page)->data != (char *)(page) + MEM_PAGE_HEADER_SIZE)
+
+// Start of the mapping holding a mapped page.
+#define mem_page_map_start(page) (mem_page_has_own_header(page)? (page)->data : (char *)(page))
+
+// The part of a mapped page that can be dropped from memory: every system
+// page after the one holding the header, if it is in the mapping.
+#define mem_page_drop_start(page) ((char *)align_up((uintptr_t)(page)->data, system_page_size()))
+#define mem_page_drop_end(page) (mem_page_map_start(page) + (page)->map_size)
+
+// The memory a page takes: its mapping, or the allocation holding it, and
+// its header.
+size_t mem_page_mapped_size(Memory_Page *page)
+{
+    if (!page->map_size) {
+        return MEM_PAGE_HEADER_SIZE + page->size;
+    }
+    return page->map_size + (mem_page_has_own_header(page)? MEM_PAGE_HEADER_SIZE : 0);
+}
+
+// Write the whole system pages of a spilled page's data, up to its cursor,
+// to the spill file and drop them from memory.  They are read back in when
+// next touched.  Returns the number of bytes newly paged out.
+size_t page_out_mem_page(Memory_Page *page)
+{
+    if (page->spill_offset < 0) {
+        return 0;
+    }
+    char *start = MAX(mem_page_drop_start(page), page->data + page->paged_out_size);
+    char *end = (char *)align_down((uintptr_t)page->cursor, system_page_size());
+    if (end <= start) {
+        return 0;
+    }
+    msync(start, end - start, MS_SYNC);
+    madvise(start, end - start, MADV_DONTNEED);
+
+    size_t paged_out_size = end - page->data;
+    size_t byte_count = paged_out_size - page->paged_out_size;
+    page->paged_out_size = paged_out_size;
+    return byte_count;
+}
+
+void free_mem_page(Memory_Page *page)
+{
+    size_t map_size = page->map_size;
+    if (map_size && mem_page_has_own_header(page)) {
+        munmap(page->data, map_size);
+        free(page);
+        return;
+    }
+    if (page->spill_offset >= 0) {
+        // Free the disk space too.  This clears the header.
+        madvise(page, map_size, MADV_REMOVE);
+    }
+    if (map_size) {
+        munmap(page, map_size);
+    } else {
+        free(page);
+    }
+}
+
+// Give the physical memory behind a mapped page back to the system, while
+// keeping the mapping for reuse.  The header is kept.
+void discard_mem_page_data(Memory_Page *page)
+{
+    if (!page->map_size) {
+        return;
+    }
+    char *start = mem_page_drop_start(page);
+    char *end = mem_page_drop_end(page);
+    if (start < end) {
+        // A spilled page's data must be removed from the file, or dropping
+        // them from memory would only write them to disk.
+        madvise(start, end - start, page->spill_offset >= 0? MADV_REMOVE : MADV_DONTNEED);
+    }
+}
+
+void init_page_pool(Page_Pool *pool, size_t max_free_bytes)
+{
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->free_bytes = 0;
+    pool->max_free_bytes = max_free_bytes;
+    pool->free_page_count = 0;
+    pool->free_page = NULL;
+    pool->spill_fd = -1;
+    pool->spill_size = 0;
+}
+
+Memory_Page *take_mem_page(Page_Pool *pool, size_t page_size)
+{
+    if (NULL != pool) {
+        pthread_mutex_lock(&pool->lock);
+        Memory_Page **link = &pool->free_page;
+        for (Memory_Page *page = pool->free_page; NULL != page; page = page->next) {
+            if (page->size == page_size) {
+                *link = page->next;
+                pool->free_bytes -= page->size;
+                --pool->free_page_count;
+                pthread_mutex_unlock(&pool->lock);
+
+                page->used = 0;
+                page->paged_out_size = 0;
+                page->cursor = page->data;
+                page->next = NULL;
+                page->prev = NULL;
+                return page;
+            }
+            link = &page->next;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (-1 != pool->spill_fd && MEM_PAGE_HEADER_SIZE + page_size >= MEM_PAGE_MMAP_THRESHOLD) {
+            return new_spill_page(pool, page_size);
+        }
+    }
+    return new_mem_page(page_size);
+}
+
+void release_mem_page(Page_Pool *pool, Memory_Page *page)
+{
+    if (NULL != pool) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->free_bytes + page->size <= pool->max_free_bytes) {
+            discard_mem_page_data(page);
+            pool->free_bytes += page->size;
+            ++pool->free_page_count;
+            page->prev = NULL;
+            page->next = pool->free_page;
+            pool->free_page = page;
+            pthread_mutex_unlock(&pool->lock);
+            return;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    free_mem_page(page);
+}
+
+void release_mempages(Page_Pool *pool, Memory_Page *first_page)
+{
+    Memory_Page *next_page = NULL;
+    for (Memory_Page *page = first_page; NULL != page; page = next_page) {
+        next_page = page->next;
+        release_mem_page(pool, page);
+    }
+}
+
 void free_mempages(Memory_Page *first_page)
 {
-    Memory_Page *page_cursor;
-    Memory_Page *next_page;
-    for (page_cursor = first_page, next_page = page_cursor->next;
+    release_mempages(NULL, first_page);
+}
 
-         NULL != next_page;
+void drain_page_pool(Page_Pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    release_mempages(NULL, pool->free_page);
+    pool->free_page = NULL;
+    pool->free_bytes = 0;
+    pool->free_page_count = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
 
-         page_cursor = next_page,
-         next_page = next_page->next)
-    {
-        free(page_cursor->data);
-        free(page_cursor);
+// Pages already mapped from the spill file stay valid after it is closed.
+void close_page_pool_spill_file(Page_Pool *pool)
+{
+    if (-1 != pool->spill_fd) {
+        close(pool->spill_fd);
+        pool->spill_fd = -1;
     }
-    free(page_cursor->data);
-    free(page_cursor);
 }
 
 #include "dymem.c"
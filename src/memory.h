@@ -3,28 +3,78 @@ typedef struct memory_page Memory_Page;
 struct memory_page {
     size_t size;
     size_t used;
+    size_t map_size;  // Size of the mapping holding the page, or 0 if malloc'd.
+    off_t spill_offset;  // Offset of the page in its pool's spill file, or -1.
+    size_t paged_out_size;  // Data of a spilled page written out and dropped.
     char *cursor;
     char *data;
     Memory_Page *next;
     Memory_Page *prev;
 };
 
+typedef struct page_pool {
+    pthread_mutex_t lock;
+    size_t free_bytes;
+    size_t max_free_bytes;
+    int free_page_count;
+    Memory_Page *free_page;  // Free pages are linked through next.
+    int spill_fd;        // Temporary file backing the large pages, or -1.
+    off_t spill_size;    // End of the last page mapped from the spill file.
+} Page_Pool;
+
 typedef struct dymem {
     size_t init_page_size;
+    size_t max_page_size;  // Each new page doubles in size up to this.
     int page_count;
+    size_t requested_bytes;   // Asked for by callers, excluding padding.
+    size_t reserved_bytes;    // Size of the pages held.
+    size_t mapped_bytes;      // Memory the pages take, with headers and rounding.
+    size_t tail_waste_bytes;  // Left unused at the ends of pages moved past.
+    size_t peak_bytes;        // Most bytes reserved at once.
+    size_t spilled_bytes;     // Paged out to the spill file.
+    Page_Pool *page_pool;
     Memory_Page *first_page;
     Memory_Page *page_cursor;
 } Dymem;
 
+typedef struct dymem_mark {
+    Memory_Page *page;
+    size_t used;
+    size_t requested_bytes;
+    size_t tail_waste_bytes;
+} Dymem_Mark;
+
 typedef struct vector {
-    size_t page_size;
+    size_t page_size;      // Size of first page.  Later pages double in size
+                           // if is_geometric is set.
     size_t el_size;
-    size_t page_el_count;
+    size_t page_el_count;  // Number of elements in first page.
     int len;
+    int is_geometric;
+    int page_count;
+    int page_dir_size;
+    int page_cursor_idx;
+    size_t reserved_bytes;  // Size of the pages held.
+    size_t mapped_bytes;    // Memory the pages take, with headers and rounding.
+    size_t peak_bytes;      // Most bytes reserved at once.
+    size_t spilled_bytes;   // Paged out to the spill file.
+    Page_Pool *page_pool;
+    Memory_Page **page_dir;
     Memory_Page *first_page;
     Memory_Page *page_cursor;
 } Vector;
 
+// What a set of Dymems and Vectors hold.  See memory-stats.c.
+typedef struct memory_stats {
+    int page_count;
+    size_t requested_bytes;
+    size_t reserved_bytes;
+    size_t mapped_bytes;
+    size_t tail_waste_bytes;
+    size_t peak_bytes;  // The sum of the peaks, which may not have coincided.
+    size_t spilled_bytes;
+} Memory_Stats;
+
 typedef struct vector_iter {
     size_t el_size;
     size_t page_size;
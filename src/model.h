@@ -1,35 +1,158 @@
 typedef struct table_cell {
     enum dytype type;
-    size_t raw_size;
-    size_t str_size;
-    char *str_data;
-    void *raw_data;
+    uint16_t display_width;  // Columns the text takes up, at most UINT16_MAX.
+    uint16_t fit_size;       // Bytes of the text that fit in COLUMN_MAX_WIDTH.
+    uint32_t str_size;       // SQLite limits text to less than 2GB.
+    uint16_t dict_code;      // Code of the text in the column's dictionary,
+                             // or 0.  See column-dictionary.c.
+    uint8_t is_partial;      // Set if the value was too large to copy, and
+                             // is read when needed.  See value-reader.c.
+    char *str_data;  // NULL for numbers until they are first displayed.
+    union {
+        int64_t data_as_int;
+        double data_as_float;
+        struct {
+            size_t raw_size;  // The length of a partial value in the db:
+                              // bytes of a BLOB, or characters of text.
+            union {
+                void *raw_data;
+                sqlite3_int64 row_key;  // rowid of a partial value's row.
+            };
+        };
+    };
 } Table_Cell;
 
 typedef struct table_memory {
-    Dymem *dymem_bin_data;
-    Dymem *dymem_str_data;
     Dymem *dymem_meta_data;
 } Table_Memory;
 
+// The rows of a large table that are currently loaded.  See
+// load_table_window.
+typedef struct table_window {
+    int row_offset;  // Position in the db table of the first row loaded.
+    int is_at_end;   // Set if the last row of the db table is loaded.
+    sqlite3_int64 db_row_count;  // Rows in the db table, or -1 until counted.
+    Vector *row_key_vec;  // rowid of each row loaded.
+    sqlite3_stmt *rows_stmt;
+    sqlite3_stmt *rows_before_stmt;
+    sqlite3_stmt *row_key_stmt;    // rowid of the row at a position.
+    sqlite3_stmt *row_count_stmt;
+} Table_Window;
+
+// Rows loaded between checks on the pool's budget, and between the
+// batches a loader publishes.  See table-loader.c.
+#define TABLE_LOADER_BATCH_SIZE 256
+
+// Loads the rows of a table in a background thread.  See table-loader.c.
+typedef struct table_loader {
+    pthread_t thread;
+    sqlite3 *db;  // The loader's own connection.
+    sqlite3_stmt *stmt;
+    struct timespec start_time;
+    struct timespec wake_time;  // When the loader last woke the main loop.
+    int row_limit;     // Most rows to load, or 0 to load every row.
+    int64_t scan_count;  // Rows stepped through by full table scans.
+    int step_status;
+    struct table_scan_segment *segment_arr;  // The segments of a parallel
+    int segment_count;                       // scan, if the loader runs one.
+    int is_done;       // Set by the loader thread.
+    int is_cancelled;  // Set by the main thread.
+} Table_Loader;
+
+typedef struct db_version {
+    int data_version;      // Changes when another connection commits.
+    int schema_version;    // Changes when the schema does.
+    int64_t change_count;  // Changes when this connection writes.
+} Db_Version;
+
+// What loading a table cost.  See load-stats.c.
+typedef struct load_stats {
+    int64_t start_ns;
+    int64_t prepare_ns;
+    int64_t step_ns;
+    int64_t copy_ns;
+    int64_t render_ns;   // The last time the table was drawn.
+    int64_t elapsed_ns;  // From the start of the load to its end.
+    int row_count;
+    int page_count;
+    size_t bytes_copied;
+    int is_done;
+} Load_Stats;
+
 typedef struct table {
     int col_count;
-    int row_count;
+    int row_count;  // Read with loaded_row_count while the table is loading.
     const char *name;
     Vector *column_vec;
     Table_Memory *data_mem;
+    Table_Window *window;  // NULL if every row of the table is loaded.
+    Table_Loader *loader;  // NULL unless rows are being loaded in the background.
+    const char *cache_key;  // Name or SQL the table was loaded from, or NULL
+                            // if the table must not be reused.
+    int ref_count;
+    Db_Version db_version;  // When the table was loaded.
+    unsigned int last_use;
+    const char *sql;        // The statement the rows were loaded with.
+    Load_Stats load_stats;  // Written by the loader while the table loads.
 } Table;
 
+#define COLUMN_WIDTH_HIST_SIZE 64
+
+// Display widths of the cells of a column, for laying out the column.  See
+// record_cell_width.
+typedef struct column_width_stats {
+    int max_width;
+    int cell_count;
+    int width_hist[COLUMN_WIDTH_HIST_SIZE];  // Cells of each width.  The last
+                                             // counts every wider cell too.
+} Column_Width_Stats;
+
+// Hash index from values to rows.  See column-index.c.
+typedef struct column_index {
+    int slot_count;  // A power of 2.
+    int row_count;   // Rows indexed so far.
+    int *slot_arr;   // Row in each slot, or -1 if the slot is empty.
+} Column_Index;
+
+// A text value stored once for every cell of a column that holds it.
+typedef struct dictionary_entry {
+    const char *str;
+    uint32_t str_size;
+    uint32_t hash;
+    uint16_t display_width;
+    uint16_t fit_size;
+} Dictionary_Entry;
+
+// The distinct text values of a column.  See column-dictionary.c.
+typedef struct column_dictionary {
+    int is_disabled;  // Set once the column has too many distinct values.
+    int value_count;  // Text cells added to the dictionary.
+    int entry_count;
+    int entry_capacity;
+    Dictionary_Entry *entry_arr;  // Entry of each code, less 1.
+    int slot_count;  // A power of 2.
+    int *slot_arr;   // Entry in each slot, or -1 if the slot is empty.
+} Column_Dictionary;
+
 typedef struct table_column {
     int cell_count;  // Number of cells in column (exc. name).
     char *name;
+    uint32_t name_hash;  // See hash_str_nocase.
     int type;
     int is_not_null;
     int is_pk;
     int is_read_only;
-    Table *fk_table;
-    struct table_column *fk_column;
+    // Foreign key target, resolved only when the key is followed.  See
+    // APP_EVENT_FOLLOW_FK and fk_column_from_table.
+    const char *fk_table_name;
+    const char *fk_column_name;  // NULL for the target's primary key.
     Vector *cell_vec;
+    Dymem *dymem_bin_data;
+    Dymem *dymem_str_data;
+    Dymem *dymem_view_data;  // Text formatted for display by the main thread.
+    Column_Index *index;     // NULL until the column is first searched.
+    Column_Width_Stats width_stats;
+    Column_Dictionary dictionary;
 } Table_Column;
 
 typedef struct record_field {
@@ -45,7 +168,15 @@ typedef struct record {
 
 typedef struct table_pool {
     int table_count;
+    unsigned int use_count;
+    size_t max_bytes;  // Memory budget of the tables, or 0 for none.
+    int is_paging_out;  // Set while over budget, so loaders page out their
+                        // tables.  See enforce_memory_budget.
+    int is_over_budget;  // Set by a load the main loop cannot stop, such as
+                         // populate_table_using_sqlite, once the pool is over
+                         // budget with no spill file, so that the load stops.
     Vector *table_vec;
+    Page_Pool page_pool;  // Shared by the memory of every table in the pool.
 } Table_Pool;
 
 typedef struct table_cursor {
@@ -62,15 +193,23 @@ enum app_view_id {
 typedef struct view_cursor {
     int row;
     int col;
+    int first_row;  // First row inside the viewport.
+    int first_col;  // First column inside the viewport.
 } View_Cursor;
 
 typedef struct table_view {
     View_Cursor cursor;
     Table *table;
+    Table *fk_lookup_table;  // Target of the foreign key under the cursor, if any.
 } Table_View;
 
 typedef struct app_model {
     sqlite3 *db;
+    int scan_worker_count;  // Threads used to load a table in full.
+    int query_row_limit;    // Most rows loaded by a console query, or 0.
+    char status_message[255];  // Shown in the status bar until the next key.
+    int is_showing_load_stats;  // Show how the table loaded in the status bar.
+    const char *memory_dump_path;  // Where to write the memory stats, or NULL.
     enum app_view_id current_view;
     Table_View user_tables;
     Vector *loaded_table_vec;
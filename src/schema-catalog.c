@@ -0,0 +1,219 @@
+/* Schema Catalog
+ * ==============
+ *
+ *  Keeps the column and foreign key metadata of every table and view in the
+ *  main schema, so that opening a table only needs the query for its data.
+ *
+ *  The catalog is read in a single query, joining pragma_table_list with
+ *  pragma_table_info and pragma_foreign_key_list for each table.  It is read
+ *  again only when PRAGMA schema_version changes, which SQLite bumps on
+ *  every change to the schema.
+ *
+ *  Names are stored once in an arena.  Tables and columns are held in two
+ *  arrays, with the columns of each table stored together in column order.
+ *  Tables are found by name through an open-addressed hash table.  As in
+ *  SQLite, names are not case sensitive.
+ *
+ *  A column with more than one foreign key records only the first.
+ */
+
+#define SCHEMA_CATALOG_MIN_SLOT_COUNT 64
+
+typedef struct catalog_column {
+    const char *name;
+    uint32_t name_hash;
+    int is_not_null;
+    int is_pk;
+    const char *fk_table_name;   // NULL if the column is not a foreign key.
+    const char *fk_column_name;  // NULL for the target's primary key.
+} Catalog_Column;
+
+typedef struct catalog_table {
+    const char *name;
+    uint32_t name_hash;
+    int has_rowid;
+    int first_col_idx;  // Position of the first column in column_arr.
+    int col_count;
+} Catalog_Table;
+
+typedef struct schema_catalog {
+    sqlite3 *db;          // NULL until the catalog is first read.
+    int schema_version;
+    int table_count;
+    int table_capacity;
+    Catalog_Table *table_arr;
+    int col_count;
+    int col_capacity;
+    Catalog_Column *column_arr;
+    int slot_count;       // A power of 2.
+    int *slot_arr;        // Table in each slot, or -1 if the slot is empty.
+    Dymem *dymem_names;
+} Schema_Catalog;
+
+Schema_Catalog global_schema_catalog;
+
+void clear_schema_catalog(Schema_Catalog *catalog)
+{
+    free(catalog->table_arr);
+    free(catalog->column_arr);
+    free(catalog->slot_arr);
+    if (NULL != catalog->dymem_names) {
+        dymem_free(catalog->dymem_names);
+    }
+    *catalog = (Schema_Catalog){ 0 };
+}
+
+Catalog_Table *push_catalog_table(Schema_Catalog *catalog)
+{
+    if (catalog->table_count == catalog->table_capacity) {
+        catalog->table_capacity = catalog->table_capacity? 2 * catalog->table_capacity : 16;
+        catalog->table_arr = (Catalog_Table *)realloc(
+                catalog->table_arr, catalog->table_capacity * sizeof(Catalog_Table));
+    }
+    return &catalog->table_arr[catalog->table_count++];
+}
+
+Catalog_Column *push_catalog_column(Schema_Catalog *catalog)
+{
+    if (catalog->col_count == catalog->col_capacity) {
+        catalog->col_capacity = catalog->col_capacity? 2 * catalog->col_capacity : 64;
+        catalog->column_arr = (Catalog_Column *)realloc(
+                catalog->column_arr, catalog->col_capacity * sizeof(Catalog_Column));
+    }
+    return &catalog->column_arr[catalog->col_count++];
+}
+
+const char *catalog_name_from_sqlite(Schema_Catalog *catalog, sqlite3_stmt *stmt, int col_idx)
+{
+    if (SQLITE_NULL == sqlite3_column_type(stmt, col_idx)) {
+        return NULL;
+    }
+    return dymem_strdup(catalog->dymem_names, (const char *)sqlite3_column_text(stmt, col_idx));
+}
+
+void index_schema_catalog(Schema_Catalog *catalog)
+{
+    int slot_count = SCHEMA_CATALOG_MIN_SLOT_COUNT;
+    while (slot_count < 2 * catalog->table_count) {
+        slot_count *= 2;
+    }
+    catalog->slot_count = slot_count;
+    catalog->slot_arr = (int *)malloc(slot_count * sizeof(int));
+    memset(catalog->slot_arr, -1, slot_count * sizeof(int));
+
+    loop (table_idx, catalog->table_count) {
+        int slot = catalog->table_arr[table_idx].name_hash & (slot_count - 1);
+        while (-1 != catalog->slot_arr[slot]) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        catalog->slot_arr[slot] = table_idx;
+    }
+}
+
+int load_schema_catalog_using_sqlite(Schema_Catalog *catalog, sqlite3 *db, int schema_version)
+{
+    sqlite3_stmt *stmt = NULL;
+    Catalog_Table *table = NULL;
+    int status = 0;
+
+    // Foreign keys are numbered from the last declared, so f.id counts down.
+    int err = prepare_cached_query_using_sqlite(db, &stmt,
+            "select l.name, l.type = 'table' and not l.wr,"
+            "       i.name, i.`notnull`, i.pk, f.`table`, f.`to`"
+            "  from pragma_table_list as l"
+            "  join pragma_table_info(l.name, l.schema) as i"
+            "  left join pragma_foreign_key_list(l.name, l.schema) as f"
+            "    on f.`from` = i.name"
+            " where l.schema = 'main'"
+            " order by l.name, i.cid, f.id desc;");
+    if (err) return err;
+
+    clear_schema_catalog(catalog);
+    catalog->dymem_names = dymem_init(KB(16));
+
+    while (SQLITE_ROW == (status = sqlite3_step(stmt))) {
+        const char *table_name = (const char *)sqlite3_column_text(stmt, 0);
+        const char *col_name = (const char *)sqlite3_column_text(stmt, 2);
+
+        if (NULL == table || 0 != strcmp(table_name, table->name)) {
+            table = push_catalog_table(catalog);
+            table->name = dymem_strdup(catalog->dymem_names, table_name);
+            table->name_hash = hash_str_nocase(table->name);
+            table->has_rowid = sqlite3_column_int(stmt, 1);
+            table->first_col_idx = catalog->col_count;
+            table->col_count = 0;
+        } else if (0 == strcmp(col_name, catalog->column_arr[catalog->col_count - 1].name)) {
+            // Another foreign key on the same column.
+            continue;
+        }
+
+        Catalog_Column *column = push_catalog_column(catalog);
+        column->name = dymem_strdup(catalog->dymem_names, col_name);
+        column->name_hash = hash_str_nocase(column->name);
+        column->is_not_null = sqlite3_column_int(stmt, 3);
+        column->is_pk = sqlite3_column_int(stmt, 4);
+        column->fk_table_name = catalog_name_from_sqlite(catalog, stmt, 5);
+        column->fk_column_name = catalog_name_from_sqlite(catalog, stmt, 6);
+        ++table->col_count;
+    }
+    if (SQLITE_DONE != status) {
+        report_error("Error (%d) reading the schema: %s", status, sqlite3_errmsg(db));
+        err = status;
+    }
+    release_cached_query(stmt);
+
+    index_schema_catalog(catalog);
+    catalog->db = db;
+    catalog->schema_version = schema_version;
+    return err;
+}
+
+// Read the catalog again if the schema has changed since it was read.
+int refresh_schema_catalog_using_sqlite(Schema_Catalog *catalog, sqlite3 *db)
+{
+    sqlite3_stmt *stmt = NULL;
+    int schema_version = -1;
+    int err = prepare_cached_query_using_sqlite(db, &stmt, "pragma schema_version;");
+    if (err) return err;
+
+    if (SQLITE_ROW == sqlite3_step(stmt)) {
+        schema_version = sqlite3_column_int(stmt, 0);
+    }
+    release_cached_query(stmt);
+
+    if (db == catalog->db && schema_version == catalog->schema_version) {
+        return 0;
+    }
+    return load_schema_catalog_using_sqlite(catalog, db, schema_version);
+}
+
+Catalog_Table *table_from_schema_catalog(Schema_Catalog *catalog, const char *name)
+{
+    if (!catalog->slot_count) {
+        return NULL;
+    }
+    uint32_t hash = hash_str_nocase(name);
+    int slot = hash & (catalog->slot_count - 1);
+    while (-1 != catalog->slot_arr[slot]) {
+        Catalog_Table *table = &catalog->table_arr[catalog->slot_arr[slot]];
+        if (hash == table->name_hash && 0 == sqlite3_stricmp(name, table->name)) {
+            return table;
+        }
+        slot = (slot + 1) & (catalog->slot_count - 1);
+    }
+    return NULL;
+}
+
+Catalog_Column *column_from_catalog_table(Schema_Catalog *catalog, Catalog_Table *table, int col_idx)
+{
+    assert(col_idx < table->col_count);
+    return &catalog->column_arr[table->first_col_idx + col_idx];
+}
+
+// Look a table up in the global catalog, reading the catalog again first if
+// the schema has changed.  Returns NULL if there is no such table.
+Catalog_Table *find_catalog_table_using_sqlite(sqlite3 *db, const char *name)
+{
+    refresh_schema_catalog_using_sqlite(&global_schema_catalog, db);
+    return table_from_schema_catalog(&global_schema_catalog, name);
+}
@@ -0,0 +1,145 @@
+/* Statement Cache
+ * ===============
+ *
+ *  Keeps prepared statements for reuse, so that running the same query again
+ *  does not pay for parsing and planning it again.
+ *
+ *  Statements are keyed by their SQL text.  Values that vary between uses,
+ *  such as the name of the table passed to a pragma, should be bound as
+ *  parameters rather than formatted into the SQL, so that one statement
+ *  serves every use.  Identifiers, which cannot be bound, are part of the
+ *  key.
+ *
+ *  A statement taken from the cache belongs to the caller until it is
+ *  released.  Releasing it resets it and clears its bindings.  If a query is
+ *  already in use, for example by a caller further up a recursive load, a
+ *  second statement is prepared for it.
+ *
+ *  The cache holds at most STMT_CACHE_SIZE statements.  When it is full, the
+ *  least recently used statement that is not in use is finalized to make
+ *  room.  If every statement is in use, the new one is prepared outside the
+ *  cache and finalized on release.
+ */
+
+#define STMT_CACHE_SIZE 64
+
+typedef struct stmt_cache_entry {
+    uint32_t hash;
+    char *sql;
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    int is_in_use;
+    unsigned int last_use;
+} Stmt_Cache_Entry;
+
+typedef struct stmt_cache {
+    int entry_count;
+    unsigned int use_count;
+    Stmt_Cache_Entry entry_arr[STMT_CACHE_SIZE];
+} Stmt_Cache;
+
+Stmt_Cache global_stmt_cache;
+
+Stmt_Cache_Entry *entry_from_stmt_cache(Stmt_Cache *cache, sqlite3_stmt *stmt)
+{
+    loop (idx, cache->entry_count) {
+        if (stmt == cache->entry_arr[idx].stmt) {
+            return &cache->entry_arr[idx];
+        }
+    }
+    return NULL;
+}
+
+// Returns a free slot, making one if the cache is full.  Returns NULL if
+// every statement is in use.
+Stmt_Cache_Entry *free_entry_from_stmt_cache(Stmt_Cache *cache)
+{
+    if (cache->entry_count < STMT_CACHE_SIZE) {
+        return &cache->entry_arr[cache->entry_count++];
+    }
+
+    Stmt_Cache_Entry *lru_entry = NULL;
+    loop (idx, cache->entry_count) {
+        Stmt_Cache_Entry *entry = &cache->entry_arr[idx];
+        if (!entry->is_in_use
+        &&  (NULL == lru_entry || entry->last_use < lru_entry->last_use)) {
+            lru_entry = entry;
+        }
+    }
+    if (NULL != lru_entry) {
+        sqlite3_finalize(lru_entry->stmt);
+        free(lru_entry->sql);
+    }
+    return lru_entry;
+}
+
+int prepare_stmt_from_stmt_cache(Stmt_Cache *cache, sqlite3 *db, sqlite3_stmt **stmt, const char *sql)
+{
+    uint32_t hash = hash_str(sql);
+
+    loop (idx, cache->entry_count) {
+        Stmt_Cache_Entry *entry = &cache->entry_arr[idx];
+        if (hash == entry->hash
+        &&  db == entry->db
+        &&  !entry->is_in_use
+        &&  0 == strcmp(sql, entry->sql)) {
+            entry->is_in_use = 1;
+            entry->last_use = ++cache->use_count;
+            *stmt = entry->stmt;
+            return 0;
+        }
+    }
+
+    int err = sqlite3_prepare_v2(db, sql, -1, stmt, NULL);
+    if (err) {
+        report_error("Error preparing statement: %s", sqlite3_errmsg(db));
+        return err;
+    }
+
+    Stmt_Cache_Entry *entry = free_entry_from_stmt_cache(cache);
+    if (NULL != entry) {
+        entry->hash = hash;
+        entry->sql = strdup(sql);
+        entry->db = db;
+        entry->stmt = *stmt;
+        entry->is_in_use = 1;
+        entry->last_use = ++cache->use_count;
+    }
+    return 0;
+}
+
+void release_stmt_from_stmt_cache(Stmt_Cache *cache, sqlite3_stmt *stmt)
+{
+    if (NULL == stmt) {
+        return;
+    }
+
+    Stmt_Cache_Entry *entry = entry_from_stmt_cache(cache, stmt);
+    if (NULL == entry) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    entry->is_in_use = 0;
+}
+
+// Finalize every statement.  Statements still in use must not be used again.
+void clear_stmt_cache(Stmt_Cache *cache)
+{
+    loop (idx, cache->entry_count) {
+        sqlite3_finalize(cache->entry_arr[idx].stmt);
+        free(cache->entry_arr[idx].sql);
+    }
+    cache->entry_count = 0;
+}
+
+int prepare_cached_query_using_sqlite(sqlite3 *db, sqlite3_stmt **stmt, const char *sql)
+{
+    return prepare_stmt_from_stmt_cache(&global_stmt_cache, db, stmt, sql);
+}
+
+void release_cached_query(sqlite3_stmt *stmt)
+{
+    release_stmt_from_stmt_cache(&global_stmt_cache, stmt);
+}
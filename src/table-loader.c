@@ -0,0 +1,492 @@
+/* Table Loader
+ * ============
+ *
+ *  Loads the rows of a table in a background thread, so that the view can
+ *  show the rows loaded so far while the rest are still being read.
+ *
+ *  The loader opens its own read-only connection to the database, and
+ *  prepares its own copy of the query that the table was created from.  Only
+ *  the loader thread writes to the table's columns while it is loading.
+ *
+ *  Rows are published in batches of TABLE_LOADER_BATCH_SIZE by storing the
+ *  table's row_count with release semantics.  The main thread reads it with
+ *  loaded_row_count, which has acquire semantics, and may then read any cell
+ *  of any row below that count.  This is safe because the cells are stored in
+ *  geometric vectors, whose page directories never move.
+ *
+ *  The loader wakes the main loop at most every TABLE_LOADER_REFRESH_MS while
+ *  it loads, so that the view can show the new rows, and again when it is
+ *  done.  The main thread must call poll_table_loader to find out when the
+ *  loader is done, and to clean it up.  Cancelling a loader waits for its thread to
+ *  stop.
+ *
+ *  Parallel Scan
+ *  -------------
+ *
+ *  A table with a rowid can also be loaded in full by several threads at
+ *  once.  The range of rowids in the table is split into one range per
+ *  worker.  Each worker reads its range through its own connection into its
+ *  own segment: a set of columns with their own cells and arenas.  The
+ *  workers are started and waited for by the loader thread, which stitches
+ *  each segment onto the table's columns once it and those before it are
+ *  done, and publishes its rows as it would a batch.  The cells are copied,
+ *  but the pages of the arenas are moved, so the cells' data do not need to
+ *  be copied.
+ *
+ *  The ranges are split by rowid value, so the work is only even if the
+ *  rowids are evenly spread.  The first rows are shown once the first
+ *  segment is done.
+ *
+ *  While the table pool is paging out (see enforce_memory_budget), the
+ *  loader and the scan workers page out the columns they write every
+ *  TABLE_LOADER_BATCH_SIZE rows.  Copying a segment's cells reads them back
+ *  in, so each column of the table is paged out again once a segment has
+ *  been stitched onto it, and the segment's column is released straight
+ *  away.  At most one segment's column is in memory at a time.  Without a
+ *  spill file, the main loop cancels a scan that takes the pool over its
+ *  budget as it would any loader.  The workers stop at the end of their
+ *  batch, and the rows before the first that was not loaded are kept.
+ */
+
+#define TABLE_LOADER_REFRESH_MS 100
+#define TABLE_LOADER_PROGRESS_STEPS 10000  // VM instructions between progress calls.
+
+int loaded_row_count(Table *table)
+{
+    return __atomic_load_n(&table->row_count, __ATOMIC_ACQUIRE);
+}
+
+int64_t elapsed_ms_since(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+// Wake the main loop so that it shows the progress of the loader, unless it
+// was woken less than TABLE_LOADER_REFRESH_MS ago.
+void wake_event_loop_from_table_loader(Table_Loader *loader)
+{
+    if (elapsed_ms_since(&loader->wake_time) >= TABLE_LOADER_REFRESH_MS) {
+        clock_gettime(CLOCK_MONOTONIC, &loader->wake_time);
+        wake_event_loop(&global_event_loop);
+    }
+}
+
+// Called by SQLite every TABLE_LOADER_PROGRESS_STEPS instructions, so that
+// progress is reported, and the loader can be cancelled, even while a query
+// runs for a long time without returning a row.
+int report_table_loader_progress(void *arg)
+{
+    Table_Loader *loader = (Table_Loader *)arg;
+    int64_t scan_count = sqlite3_stmt_status(loader->stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0);
+
+    __atomic_store_n(&loader->scan_count, scan_count, __ATOMIC_RELAXED);
+    wake_event_loop_from_table_loader(loader);
+    return __atomic_load_n(&loader->is_cancelled, __ATOMIC_RELAXED);
+}
+
+void *run_table_loader(void *arg)
+{
+    Table *table = (Table *)arg;
+    Table_Loader *loader = table->loader;
+    Load_Stats *stats = &table->load_stats;
+    Load_Timer timer;
+    int row_count = 0;
+    int status = 0;
+
+    start_load_timer(&timer);
+    while (SQLITE_ROW == (status = sqlite3_step(loader->stmt))) {
+        int is_sampled = begin_load_timer_row(&timer);
+        loop (col_idx, table->col_count) {
+            Table_Cell *cell = new_cell_from_table_using_sqlite_row(
+                table,
+                vec_seek(table->column_vec, col_idx),
+                loader->stmt,
+                col_idx,
+                -1
+            );
+            stats->bytes_copied += table_cell_data_size(cell);
+        }
+        ++row_count;
+        end_load_timer_row(&timer, is_sampled);
+        if (row_count == loader->row_limit) {
+            break;
+        }
+        if (0 == row_count % TABLE_LOADER_BATCH_SIZE) {
+            flush_load_timer(&timer, stats);
+            __atomic_store_n(&table->row_count, row_count, __ATOMIC_RELEASE);
+            if (__atomic_load_n(&loader->is_cancelled, __ATOMIC_RELAXED)) {
+                break;
+            }
+            if (__atomic_load_n(&global_table_pool->is_paging_out, __ATOMIC_RELAXED)) {
+                page_out_table(table);
+            }
+            wake_event_loop_from_table_loader(loader);
+        }
+    }
+    flush_load_timer(&timer, stats);
+    __atomic_store_n(&table->row_count, row_count, __ATOMIC_RELEASE);
+
+    loader->step_status = status;
+    __atomic_store_n(&loader->is_done, 1, __ATOMIC_RELEASE);
+    wake_event_loop(&global_event_loop);
+    return NULL;
+}
+
+Table_Loader *new_table_loader(int row_limit)
+{
+    Table_Loader *loader = (Table_Loader *)malloc(sizeof(Table_Loader));
+    loader->db = NULL;
+    loader->stmt = NULL;
+    loader->row_limit = row_limit;
+    loader->scan_count = 0;
+    loader->step_status = 0;
+    loader->segment_arr = NULL;
+    loader->segment_count = 0;
+    loader->is_done = 0;
+    loader->is_cancelled = 0;
+    clock_gettime(CLOCK_MONOTONIC, &loader->start_time);
+    loader->wake_time = loader->start_time;
+    return loader;
+}
+
+// Start loading the rows of stmt into table in the background, stopping after
+// row_limit rows unless it is 0.  Returns an error if the loader cannot be
+// started, in which case the caller must load the rows itself.
+int start_table_loader_using_sqlite(Table *table, sqlite3 *db, sqlite3_stmt *stmt, int row_limit)
+{
+    const char *filename = sqlite3_db_filename(db, "main");
+    Table_Loader *loader = NULL;
+    int err = 0;
+
+    // In-memory and temporary databases cannot be opened twice.
+    if (NULL == filename || '\0' == *filename) {
+        return 1;
+    }
+
+    loader = new_table_loader(row_limit);
+    err = sqlite3_open_v2(filename, &loader->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, 0);
+    if (!err) {
+        err = sqlite3_prepare_v2(loader->db, sqlite3_sql(stmt), -1, &loader->stmt, NULL);
+    }
+    if (!err) {
+        sqlite3_progress_handler(loader->db, TABLE_LOADER_PROGRESS_STEPS, report_table_loader_progress, loader);
+    }
+    if (!err) {
+        table->loader = loader;
+        err = pthread_create(&loader->thread, NULL, run_table_loader, table);
+    }
+    if (err) {
+        table->loader = NULL;
+        sqlite3_finalize(loader->stmt);
+        sqlite3_close_v2(loader->db);
+        free(loader);
+    }
+
+    return err;
+}
+
+void finish_table_loader(Table *table)
+{
+    Table_Loader *loader = table->loader;
+
+    pthread_join(loader->thread, NULL);
+    if (loader->segment_count) {
+        // The workers' connections are closed, so only the code is left.
+        if (SQLITE_DONE != loader->step_status) {
+            table->cache_key = NULL;
+            report_error("Error (%d) scanning %s; stopped after %d rows.",
+                         loader->step_status, table->name, table->row_count);
+        }
+    } else if (SQLITE_ROW != loader->step_status && SQLITE_INTERRUPT != loader->step_status) {
+        handle_sqlite_step_status(loader->db, loader->step_status);
+    }
+    finish_table_load_stats(table);
+    sqlite3_finalize(loader->stmt);
+    sqlite3_close_v2(loader->db);
+    free(loader);
+    table->loader = NULL;
+}
+
+// Returns 1 while the table is still loading.
+int poll_table_loader(Table *table)
+{
+    if (NULL == table->loader) {
+        return 0;
+    }
+    if (!__atomic_load_n(&table->loader->is_done, __ATOMIC_ACQUIRE)) {
+        return 1;
+    }
+    finish_table_loader(table);
+    return 0;
+}
+
+void cancel_table_loader(Table *table)
+{
+    if (NULL == table->loader) {
+        return;
+    }
+    __atomic_store_n(&table->loader->is_cancelled, 1, __ATOMIC_RELAXED);
+    if (NULL != table->loader->db) {
+        sqlite3_interrupt(table->loader->db);
+    }
+    finish_table_loader(table);
+}
+
+// Cancel the load of a table when the user asks to, keeping the rows loaded
+// so far, but never reusing the table.  Writes a message saying so to buf.
+void cancel_table_loader_for_user(Table *table, char *buf, size_t len)
+{
+    if (NULL == table->loader) {
+        return;
+    }
+    cancel_table_loader(table);
+    table->cache_key = NULL;
+    snprintf(buf, len, "Cancelled after %d rows.", table->row_count);
+}
+
+void table_loader_progress_text(Table *table, char *buf, size_t len)
+{
+    Table_Loader *loader = table->loader;
+    double elapsed = elapsed_ms_since(&loader->start_time) / 1e3;
+    int64_t scan_count = __atomic_load_n(&loader->scan_count, __ATOMIC_RELAXED);
+
+    if (scan_count) {
+        snprintf(buf, len, "Loading %s: %d rows, %lld rows scanned (%.1fs)... Ctrl-C to cancel.",
+                 table->name, loaded_row_count(table), (long long)scan_count, elapsed);
+    } else {
+        snprintf(buf, len, "Loading %s: %d rows (%.1fs)... Ctrl-C to cancel.",
+                 table->name, loaded_row_count(table), elapsed);
+    }
+}
+
+typedef struct table_scan_segment {
+    pthread_t thread;
+    Table *table;
+    const char *filename;
+    sqlite3_int64 first_key;
+    sqlite3_int64 last_key;
+    Table_Column *column_arr;
+    int row_count;
+    Load_Stats load_stats;
+    int err;
+    int is_stopped;  // Set if the segment stopped as the load was cancelled.
+} Table_Scan_Segment;
+
+void *run_table_scan_segment(void *arg)
+{
+    Table_Scan_Segment *segment = (Table_Scan_Segment *)arg;
+    Table *table = segment->table;
+    sqlite3 *db = NULL;
+    sqlite3_stmt *stmt = NULL;
+    int status = 0;
+
+    segment->err = sqlite3_open_v2(
+            segment->filename,
+            &db,
+            SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+            0);
+    if (!segment->err) {
+        // The first column of the statement is the rowid.
+        char *sql = new_preview_select_sql(table, "where rowid between ?1 and ?2 order by rowid;");
+        segment->err = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        sqlite3_free(sql);
+    }
+    if (!segment->err) {
+        sqlite3_bind_int64(stmt, 1, segment->first_key);
+        sqlite3_bind_int64(stmt, 2, segment->last_key);
+
+        Load_Stats *stats = &segment->load_stats;
+        Load_Timer timer;
+
+        start_load_timer(&timer);
+        while (SQLITE_ROW == (status = sqlite3_step(stmt))) {
+            int is_sampled = begin_load_timer_row(&timer);
+            loop (col_idx, table->col_count) {
+                Table_Cell *cell = new_cell_from_table_using_sqlite_row(
+                    table,
+                    &segment->column_arr[col_idx],
+                    stmt,
+                    col_idx + 1,
+                    0
+                );
+                stats->bytes_copied += table_cell_data_size(cell);
+            }
+            ++segment->row_count;
+            end_load_timer_row(&timer, is_sampled);
+
+            if (0 != segment->row_count % TABLE_LOADER_BATCH_SIZE) {
+                continue;
+            }
+            if (__atomic_load_n(&global_table_pool->is_paging_out, __ATOMIC_RELAXED)) {
+                loop (col_idx, table->col_count) {
+                    page_out_table_column(&segment->column_arr[col_idx]);
+                }
+            }
+            if (__atomic_load_n(&table->loader->is_cancelled, __ATOMIC_RELAXED)) {
+                segment->is_stopped = 1;
+                break;
+            }
+        }
+        flush_load_timer(&timer, stats);
+        if (SQLITE_DONE != status && !segment->is_stopped) {
+            segment->err = status;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close_v2(db);
+    return NULL;
+}
+
+// Append the rows of a segment to the table's columns, and release the
+// segment's columns.
+void stitch_table_scan_segment(Table *table, Table_Scan_Segment *segment)
+{
+    loop (col_idx, table->col_count) {
+        Table_Column *column = vec_seek(table->column_vec, col_idx);
+        Table_Column *segment_column = &segment->column_arr[col_idx];
+        vec_append(column->cell_vec, segment_column->cell_vec);
+        dymem_append(column->dymem_bin_data, segment_column->dymem_bin_data);
+        dymem_append(column->dymem_str_data, segment_column->dymem_str_data);
+        merge_column_dictionary(column, segment_column, column->cell_count);
+        column->cell_count += segment_column->cell_count;
+        merge_width_stats(&column->width_stats, &segment_column->width_stats);
+        if (__atomic_load_n(&global_table_pool->is_paging_out, __ATOMIC_RELAXED)) {
+            // The cells were read back in to be copied.
+            page_out_table_column(column);
+        }
+        free_column_data(segment_column);
+    }
+    table->load_stats.step_ns += segment->load_stats.step_ns;
+    table->load_stats.copy_ns += segment->load_stats.copy_ns;
+    table->load_stats.bytes_copied += segment->load_stats.bytes_copied;
+    __atomic_store_n(&table->row_count, table->row_count + segment->row_count, __ATOMIC_RELEASE);
+}
+
+void *run_table_scan(void *arg)
+{
+    Table *table = (Table *)arg;
+    Table_Loader *loader = table->loader;
+    int started_count = 0;
+    int is_stopped = 0;
+    int err = 0;
+
+    loop (idx, loader->segment_count) {
+        Table_Scan_Segment *segment = &loader->segment_arr[idx];
+        err = pthread_create(&segment->thread, NULL, run_table_scan_segment, segment);
+        if (err) {
+            break;
+        }
+        ++started_count;
+    }
+
+    // Stitch the segments onto the table in order, as each is done.  Once a
+    // segment fails or stops, the rows after it are dropped.
+    loop (idx, loader->segment_count) {
+        Table_Scan_Segment *segment = &loader->segment_arr[idx];
+        if (idx < started_count) {
+            pthread_join(segment->thread, NULL);
+        }
+        if (!err) {
+            err = segment->err;
+        }
+        if (!err && !is_stopped) {
+            stitch_table_scan_segment(table, segment);
+            wake_event_loop_from_table_loader(loader);
+        } else {
+            loop (col_idx, table->col_count) {
+                free_column_data(&segment->column_arr[col_idx]);
+            }
+        }
+        is_stopped |= segment->is_stopped;
+        free(segment->column_arr);
+    }
+    free(loader->segment_arr);
+    loader->segment_arr = NULL;
+
+    loader->step_status = err? err : SQLITE_DONE;
+    __atomic_store_n(&loader->is_done, 1, __ATOMIC_RELEASE);
+    wake_event_loop(&global_event_loop);
+    return NULL;
+}
+
+// Start loading every row of a table with a rowid in the background, using
+// worker_count threads.  Returns an error if the scan cannot be started, in
+// which case the caller must load the rows another way.
+int start_table_scan_using_sqlite(Table *table, sqlite3 *db, int worker_count)
+{
+    const char *filename = sqlite3_db_filename(db, "main");
+    Page_Pool *page_pool = table->column_vec->page_pool;
+    sqlite3_stmt *stmt = NULL;
+    sqlite3_int64 min_key = 0;
+    sqlite3_int64 max_key = 0;
+    char sql[255];
+    int err = 0;
+
+    // In-memory and temporary databases cannot be opened twice.
+    if (NULL == filename || '\0' == *filename) {
+        return 1;
+    }
+
+    sprintf(sql, "select min(rowid), max(rowid) from %s;", table->name);
+    err = prepare_cached_query_using_sqlite(db, &stmt, sql);
+    if (err) return err;
+
+    if (SQLITE_ROW != sqlite3_step(stmt) || SQLITE_NULL == sqlite3_column_type(stmt, 0)) {
+        // The table is empty.
+        release_cached_query(stmt);
+        finish_table_load_stats(table);
+        return 0;
+    }
+    min_key = sqlite3_column_int64(stmt, 0);
+    max_key = sqlite3_column_int64(stmt, 1);
+    release_cached_query(stmt);
+
+    // Split the keys into one range per worker.  Unsigned arithmetic is used
+    // as the span of keys may not fit in a signed int.
+    uint64_t key_span = (uint64_t)max_key - (uint64_t)min_key;
+    uint64_t range_size = key_span / worker_count + 1;
+
+    Table_Loader *loader = new_table_loader(0);
+    loader->segment_arr = (Table_Scan_Segment *)malloc(worker_count * sizeof(Table_Scan_Segment));
+
+    while (loader->segment_count < worker_count && loader->segment_count * range_size <= key_span) {
+        Table_Scan_Segment *segment = &loader->segment_arr[loader->segment_count];
+        uint64_t first_key = (uint64_t)min_key + loader->segment_count * range_size;
+
+        segment->table = table;
+        segment->filename = filename;
+        segment->first_key = (sqlite3_int64)first_key;
+        segment->last_key = loader->segment_count == worker_count - 1
+                          ? max_key
+                          : (sqlite3_int64)(first_key + range_size - 1);
+        segment->row_count = 0;
+        segment->load_stats = (Load_Stats){ 0 };
+        segment->err = 0;
+        segment->is_stopped = 0;
+        segment->column_arr = (Table_Column *)malloc(table->col_count * sizeof(Table_Column));
+        loop (col_idx, table->col_count) {
+            init_column_data(&segment->column_arr[col_idx], page_pool);
+        }
+        ++loader->segment_count;
+    }
+
+    table->loader = loader;
+    err = pthread_create(&loader->thread, NULL, run_table_scan, table);
+    if (err) {
+        table->loader = NULL;
+        loop (idx, loader->segment_count) {
+            Table_Scan_Segment *segment = &loader->segment_arr[idx];
+            loop (col_idx, table->col_count) {
+                free_column_data(&segment->column_arr[col_idx]);
+            }
+            free(segment->column_arr);
+        }
+        free(loader->segment_arr);
+        free(loader);
+    }
+
+    return err;
+}
@@ -13,8 +13,195 @@ void enable_curses()
     initscr();
     raw();
     keypad(stdscr, TRUE);
+    idlok(stdscr, TRUE);  // Let scrolling use the terminal's line operations.
     start_color();
     init_pair(1, COLOR_BLACK, COLOR_BLUE);  // Cursor colours.
     clear();
     noecho();
+    nodelay(stdscr, TRUE);  // The main loop polls stdin.  See event-loop.c.
+}
+
+// Write value to buf as decimal text.  buf must hold at least
+// TEXT_LEN_FOR_LARGEST_INT + 1 bytes.  Returns the length of the text.
+int format_int64(char *buf, int64_t value)
+{
+    char digits[TEXT_LEN_FOR_LARGEST_INT];
+    uint64_t magnitude = value < 0? -(uint64_t)value : (uint64_t)value;
+    int digit_count = 0;
+    int len = 0;
+
+    do {
+        digits[digit_count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) {
+        buf[len++] = '-';
+    }
+    while (digit_count) {
+        buf[len++] = digits[--digit_count];
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+// Read str as an integer, if it is one written the way format_int64 would
+// write it.  Returns 0 if it is not.
+int parse_int64(const char *str, int64_t *value)
+{
+    char buf[TEXT_LEN_FOR_LARGEST_INT + 1];
+    char *end = NULL;
+    long long parsed = strtoll(str, &end, 10);
+
+    // The round trip rejects leading zeros, spaces and signs, and values out
+    // of range, which strtoll clamps.
+    if (end == str || '\0' != *end) {
+        return 0;
+    }
+    format_int64(buf, parsed);
+    if (0 != strcmp(buf, str)) {
+        return 0;
+    }
+    *value = parsed;
+    return 1;
+}
+
+// Write value to buf the way sqlite would display it.  buf must hold at least
+// TEXT_LEN_FOR_LARGEST_FLOAT + 1 bytes.  Returns the length of the text.
+int format_double(char *buf, double value)
+{
+    int len = snprintf(buf, TEXT_LEN_FOR_LARGEST_FLOAT + 1, "%.15g", value);
+
+    // Like sqlite, show that whole numbers are floats.
+    if (NULL == strpbrk(buf, ".eni") && len + 2 <= TEXT_LEN_FOR_LARGEST_FLOAT) {
+        buf[len++] = '.';
+        buf[len++] = '0';
+        buf[len] = '\0';
+    }
+    return len;
+}
+
+// Decode the character at the start of text, of at most len bytes.  Bytes
+// that are not valid UTF-8 are decoded one at a time, as U+FFFD.  Returns the
+// size of the character in bytes.
+int decode_utf8(const unsigned char *text, size_t len, uint32_t *code_point)
+{
+    int size = 0;
+    uint32_t cp = 0;
+
+    if (text[0] < 0x80) {
+        *code_point = text[0];
+        return 1;
+    } else if ((text[0] & 0xe0) == 0xc0) {
+        size = 2; cp = text[0] & 0x1f;
+    } else if ((text[0] & 0xf0) == 0xe0) {
+        size = 3; cp = text[0] & 0x0f;
+    } else if ((text[0] & 0xf8) == 0xf0) {
+        size = 4; cp = text[0] & 0x07;
+    }
+    if (!size || (size_t)size > len) {
+        *code_point = 0xfffd;
+        return 1;
+    }
+    loop_from (idx, 1, size) {
+        if ((text[idx] & 0xc0) != 0x80) {
+            *code_point = 0xfffd;
+            return 1;
+        }
+        cp = (cp << 6) | (text[idx] & 0x3f);
+    }
+    *code_point = cp;
+    return size;
+}
+
+// The number of terminal columns that the UTF-8 text str, of len bytes,
+// takes up.  Sets *fit_size to the size in bytes of the longest prefix of the
+// text that takes up no more than max_width columns.
+int utf8_display_width(const char *str, size_t len, int max_width, size_t *fit_size)
+{
+    const unsigned char *text = (const unsigned char *)str;
+    size_t pos = 0;
+
+    // ASCII takes one column a byte, so is measured eight bytes at a time.
+    while (pos + 8 <= len) {
+        uint64_t word;
+        memcpy(&word, text + pos, 8);
+        if (word & 0x8080808080808080ull) {
+            break;
+        }
+        pos += 8;
+    }
+    while (pos < len && text[pos] < 0x80) {
+        ++pos;
+    }
+
+    int width = pos;
+    *fit_size = width <= max_width? pos : (size_t)max_width;
+
+    while (pos < len) {
+        uint32_t code_point = 0;
+        int size = decode_utf8(text + pos, len - pos, &code_point);
+        int char_width = code_point < 0x80? 1 : wcwidth(code_point);
+        if (char_width < 0) {
+            // Not printable in this locale; curses shows it in one column.
+            char_width = 1;
+        }
+        if (*fit_size == pos && width + char_width <= max_width) {
+            *fit_size = pos + size;
+        }
+        width += char_width;
+        pos += size;
+    }
+    return width;
+}
+
+uint32_t hash_str(const char *str)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// As hash_str, but over len bytes, which may include NULs.
+uint32_t hash_bytes(const char *data, size_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t idx = 0; idx < len; ++idx) {
+        hash ^= (unsigned char)data[idx];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t hash_str_nocase(const char *str)
+{
+    // FNV-1a, over ASCII folded to lower case, as SQLite folds identifiers.
+    uint32_t hash = 2166136261u;
+    while (*str) {
+        unsigned char ch = *str++;
+        if (ch >= 'A' && ch <= 'Z') {
+            ch += 'a' - 'A';
+        }
+        hash ^= ch;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t hash_int64(int64_t value)
+{
+    // The splitmix64 finalizer, so that sequential keys spread over the
+    // table.
+    uint64_t x = (uint64_t)value;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return (uint32_t)x;
 }
@@ -16,6 +16,13 @@ enum dytype {
 // Unverified. See https://stackoverflow.com/a/1701085
 #define TEXT_LEN_FOR_LARGEST_FLOAT 24
 
+#ifndef MIN
+#define MIN(a, b) ((a) < (b)? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b)? (a) : (b))
+#endif
+
 #define return_on_err(x) if ((x)) return;
 
 #define loop(x, count) for (int (x) = 0; (x) < (count); (++x))
@@ -0,0 +1,193 @@
+/* Value Reader
+ * ============
+ *
+ *  Reads the whole value of a cell, for the value viewer.  A partial cell
+ *  only holds a preview of its value, so the value is read from the
+ *  database through sqlite3_blob_read, a page of VALUE_READER_PAGE_SIZE
+ *  bytes at a time, as the viewer scrolls to it.  The value of any other
+ *  cell is read from memory.
+ *
+ *  Text is split into lines at newlines, and wraps at the viewer's width.
+ *  Lines can only be found in order, so the start of each line found so far
+ *  is kept for scrolling back.  BLOBs are shown as a hex dump, with
+ *  VALUE_READER_HEX_WIDTH bytes a line, so any line can be read at once.
+ *
+ *  Values are read as they are stored, so text in a database that is not
+ *  UTF-8 is shown as its bytes.  A reader uses the app's connection, so
+ *  belongs to the main thread.  If the row changes while it is open, reads
+ *  fail, and the rest of the value is not shown.
+ */
+
+#define VALUE_READER_PAGE_SIZE 4096
+#define VALUE_READER_HEX_WIDTH 16
+#define VALUE_READER_LINE_LEN 1024  // Longest line, with the terminating NUL.
+
+typedef struct value_reader {
+    sqlite3_blob *blob;  // NULL if the value is in memory.
+    const char *data;    // The value, if it is in memory.
+    size_t size;
+    int is_binary;
+    int width;    // Columns of a line of text.  Set before reading lines.
+    int err;      // Set if a read failed.
+    char page[VALUE_READER_PAGE_SIZE];
+    size_t page_offset;
+    size_t page_size;  // Bytes of the page read, or 0 if none has been.
+    int line_count;    // Lines of text found so far.
+    int line_capacity;
+    size_t *line_start_arr;  // Offset of each line of text found.
+    int is_at_end;     // Set once the last line of text is found.
+} Value_Reader;
+
+// Open the value of a cell of table.  Returns 0, or the SQLite error if the
+// value cannot be read from the database.
+int open_value_reader_using_sqlite(Value_Reader *reader, sqlite3 *db, Table *table, Table_Column *column, Table_Cell *cell)
+{
+    memset(reader, 0, sizeof(Value_Reader));
+    reader->is_binary = DYTYPE_BLOB == cell->type;
+    reader->width = COLUMN_MAX_WIDTH;
+
+    if (cell->is_partial) {
+        int err = sqlite3_blob_open(db, "main", table->name, column->name, cell->row_key, 0, &reader->blob);
+        if (err) {
+            reader->blob = NULL;
+            return err;
+        }
+        reader->size = sqlite3_blob_bytes(reader->blob);
+    } else if (reader->is_binary) {
+        reader->data = (const char *)cell->raw_data;
+        reader->size = cell->raw_size;
+    } else {
+        reader->data = str_from_table_cell(column, cell);
+        reader->size = cell->str_size;
+    }
+    return 0;
+}
+
+void close_value_reader(Value_Reader *reader)
+{
+    sqlite3_blob_close(reader->blob);
+    free(reader->line_start_arr);
+    reader->blob = NULL;
+    reader->line_start_arr = NULL;
+}
+
+// Copy up to len bytes of the value from offset to buf, reading pages from
+// the database as needed.  Returns the number of bytes copied.
+size_t read_value(Value_Reader *reader, size_t offset, char *buf, size_t len)
+{
+    if (offset >= reader->size) {
+        return 0;
+    }
+    len = MIN(len, reader->size - offset);
+    if (NULL == reader->blob) {
+        memcpy(buf, reader->data + offset, len);
+        return len;
+    }
+
+    size_t copied = 0;
+    while (copied < len) {
+        size_t pos = offset + copied;
+        if (!reader->page_size || pos < reader->page_offset || pos >= reader->page_offset + reader->page_size) {
+            size_t page_offset = pos - pos % VALUE_READER_PAGE_SIZE;
+            size_t page_size = MIN(VALUE_READER_PAGE_SIZE, reader->size - page_offset);
+            reader->page_size = 0;
+            reader->err = sqlite3_blob_read(reader->blob, reader->page, page_size, page_offset);
+            if (reader->err) {
+                break;
+            }
+            reader->page_offset = page_offset;
+            reader->page_size = page_size;
+        }
+        size_t size = MIN(len - copied, reader->page_offset + reader->page_size - pos);
+        memcpy(buf + copied, reader->page + (pos - reader->page_offset), size);
+        copied += size;
+    }
+    return copied;
+}
+
+// Read the line of text starting at offset into buf, which must hold
+// VALUE_READER_LINE_LEN bytes, with control characters shown as spaces.
+// Returns the offset of the next line.
+size_t read_value_text_line(Value_Reader *reader, size_t offset, char *buf)
+{
+    size_t max_size = MIN((size_t)reader->width * 4, VALUE_READER_LINE_LEN - 1);
+    size_t size = read_value(reader, offset, buf, max_size);
+    char *newline = (char *)memchr(buf, '\n', size);
+    size_t line_size = NULL != newline? (size_t)(newline - buf) : size;
+    size_t fit_size = 0;
+
+    loop (idx, line_size) {
+        if ((unsigned char)buf[idx] < ' ' || 0x7f == buf[idx]) {
+            buf[idx] = ' ';
+        }
+    }
+    utf8_display_width(buf, line_size, reader->width, &fit_size);
+    if (fit_size < line_size) {
+        // Wrap, but always make progress, even past a character wider than
+        // the line.
+        line_size = MAX(fit_size, 1);
+        buf[line_size] = '\0';
+        return offset + line_size;
+    }
+    buf[line_size] = '\0';
+    return offset + line_size + (NULL != newline);
+}
+
+void push_value_line_start(Value_Reader *reader, size_t offset)
+{
+    if (reader->line_count == reader->line_capacity) {
+        reader->line_capacity = reader->line_capacity? 2 * reader->line_capacity : 256;
+        reader->line_start_arr = (size_t *)realloc(
+                reader->line_start_arr, reader->line_capacity * sizeof(size_t));
+    }
+    reader->line_start_arr[reader->line_count++] = offset;
+}
+
+void hex_dump_line(Value_Reader *reader, int line_idx, char *buf)
+{
+    unsigned char bytes[VALUE_READER_HEX_WIDTH];
+    size_t offset = (size_t)line_idx * VALUE_READER_HEX_WIDTH;
+    size_t size = read_value(reader, offset, (char *)bytes, VALUE_READER_HEX_WIDTH);
+    int len = sprintf(buf, "%08zx", offset);
+
+    loop (idx, VALUE_READER_HEX_WIDTH) {
+        len += (size_t)idx < size
+             ? sprintf(buf + len, " %02x", bytes[idx])
+             : sprintf(buf + len, "   ");
+    }
+    len += sprintf(buf + len, "  ");
+    loop (idx, size) {
+        buf[len++] = bytes[idx] >= ' ' && bytes[idx] < 0x7f? bytes[idx] : '.';
+    }
+    buf[len] = '\0';
+}
+
+// Write line line_idx of the value to buf, which must hold
+// VALUE_READER_LINE_LEN bytes.  Returns 0 if the value has no such line.
+int read_value_line(Value_Reader *reader, int line_idx, char *buf)
+{
+    if (reader->is_binary) {
+        if ((size_t)line_idx * VALUE_READER_HEX_WIDTH >= reader->size) {
+            return 0;
+        }
+        hex_dump_line(reader, line_idx, buf);
+        return 1;
+    }
+
+    if (!reader->line_count) {
+        push_value_line_start(reader, 0);
+    }
+    while (line_idx >= reader->line_count && !reader->is_at_end) {
+        size_t next = read_value_text_line(reader, reader->line_start_arr[reader->line_count - 1], buf);
+        if (next >= reader->size || reader->err) {
+            reader->is_at_end = 1;
+        } else {
+            push_value_line_start(reader, next);
+        }
+    }
+    if (line_idx >= reader->line_count) {
+        return 0;
+    }
+    read_value_text_line(reader, reader->line_start_arr[line_idx], buf);
+    return 1;
+}
@@ -1,28 +1,122 @@
+#define VEC_INIT_PAGE_DIR_SIZE 8
+
+// A geometric vector cannot have more pages than there are bits in its size.
+#define VEC_GEOMETRIC_PAGE_DIR_SIZE (8 * sizeof(size_t))
+
+size_t vec_page_el_count(Vector *vec, int page_idx)
+{
+    if (vec->is_geometric) {
+        return vec->page_el_count << page_idx;
+    }
+    return vec->page_el_count;
+}
+
+Memory_Page *vec_append_page(Vector *vec)
+{
+    if (vec->page_count == vec->page_dir_size) {
+        // The directory of a geometric vector must never move.
+        assert(!vec->is_geometric);
+
+        vec->page_dir = (Memory_Page **)realloc(
+                vec->page_dir,
+                2 * vec->page_dir_size * sizeof(Memory_Page *));
+        memset(vec->page_dir + vec->page_dir_size, 0, vec->page_dir_size * sizeof(Memory_Page *));
+        vec->page_dir_size *= 2;
+    }
+
+    Memory_Page *page = take_mem_page(
+            vec->page_pool,
+            vec->el_size * vec_page_el_count(vec, vec->page_count));
+    if (vec->page_count) {
+        Memory_Page *last_page = vec->page_dir[vec->page_count - 1];
+        last_page->next = page;
+        page->prev = last_page;
+    }
+    vec->page_dir[vec->page_count] = page;
+    ++vec->page_count;
+    vec->reserved_bytes += page->size;
+    vec->mapped_bytes += mem_page_mapped_size(page);
+    vec->peak_bytes = MAX(vec->peak_bytes, vec->reserved_bytes);
+
+    return page;
+}
+
 // TODO: Allocate this from mem manager and init here.
-Vector *new_vector(const size_t el_size, const int el_count)
+Vector *new_vector_in_page_pool(
+        Page_Pool *pool,
+        const size_t el_size,
+        const int el_count,
+        int is_geometric)
 {
     Vector *vec = (Vector *)malloc(sizeof(Vector));
+    vec->page_pool = pool;
     vec->el_size = el_size;
     vec->page_size = el_size * el_count;
     vec->page_el_count = el_count;
     vec->len = 0;
-    vec->first_page = new_mem_page(vec->page_size);
+    vec->is_geometric = is_geometric;
+    vec->page_count = 0;
+    vec->reserved_bytes = 0;
+    vec->mapped_bytes = 0;
+    vec->peak_bytes = 0;
+    vec->spilled_bytes = 0;
+    vec->page_dir_size = is_geometric? VEC_GEOMETRIC_PAGE_DIR_SIZE : VEC_INIT_PAGE_DIR_SIZE;
+    vec->page_dir = (Memory_Page **)calloc(vec->page_dir_size, sizeof(Memory_Page *));
+    vec->first_page = vec_append_page(vec);
     vec->page_cursor = vec->first_page;
+    vec->page_cursor_idx = 0;
     *vec->page_cursor->data = '\0';
     return vec;
 }
 
+Vector *new_vector(const size_t el_size, const int el_count)
+{
+    return new_vector_in_page_pool(NULL, el_size, el_count, 0);
+}
+
+// Each page holds twice as many elements as the one before it, so a vector of
+// n elements needs only log2(n) pages.
+Vector *new_geometric_vector(const size_t el_size, const int el_count)
+{
+    return new_vector_in_page_pool(NULL, el_size, el_count, 1);
+}
+
 void delete_vector(Vector *vec)
 {
-    free_mempages(vec->first_page);
+    release_mempages(vec->page_pool, vec->first_page);
+    free(vec->page_dir);
     free(vec);
 }
 
+// Remove every element, keeping the pages for reuse.
+void vec_clear(Vector *vec)
+{
+    loop (idx, vec->page_count) {
+        vec->page_dir[idx]->used = 0;
+        vec->page_dir[idx]->cursor = vec->page_dir[idx]->data;
+        vec->page_dir[idx]->paged_out_size = 0;
+    }
+    vec->len = 0;
+    vec->spilled_bytes = 0;
+    vec->page_cursor = vec->first_page;
+    vec->page_cursor_idx = 0;
+}
+
+// Page out the elements pushed so far.  Only the thread pushing to vec may
+// call this.
+void page_out_vector(Vector *vec)
+{
+    loop (idx, vec->page_cursor_idx + 1) {
+        vec->spilled_bytes += page_out_mem_page(vec->page_dir[idx]);
+    }
+}
+
 void reset_vector_iter(Vector_Iter *veci)
 {
     veci->page_offset = 0;
     veci->step = 0;
     veci->page = veci->first_page;
+    veci->page_size = veci->page->size;
     veci->cursor = veci->page->data;
 }
 
@@ -30,7 +124,6 @@ Vector_Iter *new_vector_iter(Vector *vec)
 {
     Vector_Iter *veci = (Vector_Iter *)malloc(sizeof(Vector_Iter));
 
-    veci->page_size = vec->page_size;
     veci->el_size = vec->el_size;
     veci->len = vec->len;
     veci->first_page = vec->first_page;
@@ -50,31 +143,63 @@ void delete_vector_iter(Vector_Iter *veci)
     }
 }
 
-void *vec_push_empty(Vector *vec)
+// Advance the page cursor once the current page is full, so that it always
+// points to a page with room for another element.
+void vec_advance_page_cursor(Vector *vec)
 {
-    void *cursor = vec->page_cursor->cursor;
-
-    vec->page_cursor->used += vec->el_size;
-    ++vec->len;
     if (vec->page_cursor->used >= vec->page_cursor->size) {
         // Used memory should never exceed page size.  If it has, a data
         // corruption has occured and we must abort.
         assert(vec->page_cursor->used == vec->page_cursor->size);
 
         if (NULL == vec->page_cursor->next) {
-            vec->page_cursor->next = new_mem_page(vec->page_size);
+            vec_append_page(vec);
         }
-        vec->page_cursor->next->prev = vec->page_cursor;
         vec->page_cursor = vec->page_cursor->next;
-        vec->page_cursor->cursor = vec->page_cursor->data; 
-    } else {
-        assert(vec->page_cursor->used <= vec->page_cursor->size - vec->el_size);
-        vec->page_cursor->cursor += vec->el_size;
+        ++vec->page_cursor_idx;
+        vec->page_cursor->cursor = vec->page_cursor->data;
     }
+}
+
+void *vec_push_empty(Vector *vec)
+{
+    void *cursor = vec->page_cursor->cursor;
+
+    vec->page_cursor->used += vec->el_size;
+    vec->page_cursor->cursor += vec->el_size;
+    ++vec->len;
+    vec_advance_page_cursor(vec);
 
     return cursor;
 }
 
+// Copy every element of src to the end of vec.
+void vec_append(Vector *vec, Vector *src)
+{
+    assert(vec->el_size == src->el_size);
+
+    loop (page_idx, src->page_count) {
+        Memory_Page *src_page = src->page_dir[page_idx];
+        char *src_cursor = src_page->data;
+        size_t remaining = src_page->used;
+
+        while (remaining) {
+            Memory_Page *page = vec->page_cursor;
+            size_t chunk = page->size - page->used;
+            if (chunk > remaining) {
+                chunk = remaining;
+            }
+            memcpy(page->cursor, src_cursor, chunk);
+            page->used += chunk;
+            page->cursor += chunk;
+            vec->len += chunk / vec->el_size;
+            src_cursor += chunk;
+            remaining -= chunk;
+            vec_advance_page_cursor(vec);
+        }
+    }
+}
+
 void vec_push(Vector *vec, void *el_src)
 {
     char *cursor = vec_push_empty(vec);
@@ -84,11 +209,16 @@ void vec_push(Vector *vec, void *el_src)
 void *vec_pop(Vector *vec)
 {
     if (vec->len) {
-        vec->page_cursor->cursor -= vec->el_size;
-        if (vec->page_cursor->cursor < (char *)vec->page_cursor) {
+        if (vec->page_cursor->cursor == vec->page_cursor->data) {
+            // The cursor is at the start of an empty page, so the last
+            // element is at the end of the previous one.
             vec->page_cursor = vec->page_cursor->prev;
-            vec->page_cursor->cursor = (char *)vec->page_cursor + vec->page_size - vec->el_size;
+            --vec->page_cursor_idx;
+            vec->spilled_bytes -= vec->page_cursor->paged_out_size;
+            vec->page_cursor->paged_out_size = 0;
+            vec->page_cursor->cursor = vec->page_cursor->data + vec->page_cursor->size;
         }
+        vec->page_cursor->cursor -= vec->el_size;
         vec->page_cursor->used -= vec->el_size;
         --vec->len;
         return vec->page_cursor->cursor;
@@ -96,24 +226,27 @@ void *vec_pop(Vector *vec)
     return NULL;
 }
 
+// Index of the highest set bit of x.  x must not be 0.
+#define floor_log2(x) (8 * sizeof(unsigned long) - 1 - __builtin_clzl(x))
+
 void *vec_seek(Vector *vec, size_t idx)
 {
-    const size_t page_size = vec->page_size;
-    const size_t el_size = vec->el_size;
-
-    Memory_Page *page = vec->first_page;
+    size_t page_idx = 0;
+    size_t page_offset = 0;
 
-    int page_number = 1;
-    while (page_number * page->size <= idx * el_size) {
-        page = page->next;
-        ++page_number;
+    if (vec->is_geometric) {
+        // Page n starts at element page_el_count * (2^n - 1).
+        page_idx = floor_log2(idx / vec->page_el_count + 1);
+        page_offset = idx - vec->page_el_count * (((size_t)1 << page_idx) - 1);
+    } else {
+        page_idx = idx / vec->page_el_count;
+        page_offset = idx % vec->page_el_count;
     }
-    char *el = page->data;
-    size_t offset_to_page = (page_number - 1) * vec->page_el_count;
-    size_t page_offset = idx - offset_to_page; 
+    // The page count is not read here, as it may be changed by a thread
+    // pushing to the vector.
+    assert(page_idx < (size_t)vec->page_dir_size && NULL != vec->page_dir[page_idx]);
 
-    el += page_offset * el_size;
-    return (void *)el;
+    return (void *)(vec->page_dir[page_idx]->data + page_offset * vec->el_size);
 }
 
 void *vec_next(Vector_Iter *veci)
@@ -138,6 +271,7 @@ void *vec_next(Vector_Iter *veci)
         assert(NULL != veci->page->next);
 
         veci->page = veci->page->next;
+        veci->page_size = veci->page->size;
         veci->page_offset = 0;
         veci->cursor = veci->page->data;
     }
@@ -1,12 +1,25 @@
+Table_Widget_State global_table_widget_state;
+
+// Forget what is on the screen, so that the next view is drawn in full.
+void invalidate_view()
+{
+    global_table_widget_state.table = NULL;
+}
+
 void view_table(View_Table_Model model)
 {
-    clear();
-    attron(A_BOLD);
-        mvprintw(2, 1, "%s", model.table->name);
-    attroff(A_BOLD);
-    table_widget(model.table, model.cursor);
+    int64_t render_start_ns = monotonic_ns();
+    int is_redrawn = table_widget(
+            model.table, model.cursor, model.fk_lookup_table,
+            &global_table_widget_state);
+    model.table->load_stats.render_ns = monotonic_ns() - render_start_ns;
+    if (is_redrawn) {
+        attron(A_BOLD);
+            mvprintw(2, 1, "%s", model.table->name);
+        attroff(A_BOLD);
+    }
 
-    char help_msg[255] = "Options are (q)uit and (e)dit.\n";
+    char help_msg[255] = "Options are (q)uit, (e)dit, (v)alue, (:) query, (t)imings, e(x)plain, (L)og, (M)emory.";
     if (model.status_bar_text && strlen(model.status_bar_text)) {
         status_bar_widget(model.status_bar_text);
     } else {
@@ -2,5 +2,18 @@ typedef struct view_table_model {
     char *table_name;
     View_Cursor *cursor;
     Table *table;
+    Table *fk_lookup_table;
     char *status_bar_text;
 } View_Table_Model;
+
+// What the table widget last drew.  See table_widget.
+typedef struct table_widget_state {
+    Table *table;  // NULL if the screen must be drawn in full.
+    Table *fk_lookup_table;
+    View_Cursor cursor;
+    uint32_t col_layout_hash;
+    int row_count;
+    int row_offset;
+    int lines;
+    int cols;
+} Table_Widget_State;
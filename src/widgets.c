@@ -1,75 +1,477 @@
+#define TABLE_WIDGET_MAX_VISIBLE_COLS 128
+#define COLUMN_MIN_WIDTH 4
+#define COLUMN_PADDING 2
+
 typedef struct table_widget_layout {
     int offset;
-    int column_width;
+    int visible_row_count;
+    int last_col;  // One past the last column inside the viewport.
+    int col_x_arr[TABLE_WIDGET_MAX_VISIBLE_COLS];      // From cursor->first_col.
+    int col_width_arr[TABLE_WIDGET_MAX_VISIBLE_COLS];  // Exc. padding.
+    uint32_t col_layout_hash;
 } Table_Widget_Layout;
 
-void table_widget(Table *table, View_Cursor *cursor)
+// Rows of another table that a foreign key column refers to.
+typedef struct fk_lookup {
+    Table *table;
+    Table_Column *fk_column;     // NULL if the key is not shown.
+    Table_Column *key_column;
+    Table_Column *label_column;
+} Fk_Lookup;
+
+// The text of a cell, followed by the label of the row it refers to if the
+// cell is the key being looked up.
+const char *cell_text_with_lookup(Table_Column *column, Table_Cell *cell, Fk_Lookup *lookup, char *buf, size_t buf_size)
+{
+    const char *text = str_from_table_cell(column, cell);
+    if (column != lookup->fk_column) {
+        return text;
+    }
+    char label[COLUMN_MAX_WIDTH * 4 + 1];
+    int row_idx = row_from_column_index(lookup->table, lookup->key_column, column, cell);
+    if (row_idx < 0) {
+        // The row may be outside the window loaded.
+        if (NULL != lookup->table->window
+        &&  label_from_table_using_sqlite(lookup->table, lookup->key_column, lookup->label_column,
+                                          column, cell, label, sizeof(label))) {
+            snprintf(buf, buf_size, "%s (%s)", text, label);
+            return buf;
+        }
+        return text;
+    }
+    Table_Cell *label_cell = (Table_Cell *)vec_seek(lookup->label_column->cell_vec, row_idx);
+    snprintf(buf, buf_size, "%s (%s)", text, str_from_table_cell(lookup->label_column, label_cell));
+    return buf;
+}
+
+// Draw text at the cursor, truncated or padded to width columns.  fit_size
+// is the size in bytes of the part of the text that fits.
+void fixed_width_text_widget(const char *text, size_t fit_size, int width)
 {
-    Table_Widget_Layout table_layout = { 4, 20 };
-    Table_Column *column = NULL;
-    Table_Cell *cell = NULL;
-
-    mvprintw(0, 0, "%d columns, %d rows.\n", table->col_count, table->row_count);
-    int col_idx = 0;
-    Vector_Iter *col_iter = new_vector_iter(table->column_vec);
-    vec_loop (col_iter, Table_Column, column) {
-        // Display table header.
+    int y = getcury(stdscr);
+    int end_x = getcurx(stdscr) + width;
+    if (end_x > COLS) end_x = COLS;
+
+    addnstr(text, fit_size);
+
+    // The cursor wraps to the next line at the edge of the screen.
+    if (getcury(stdscr) == y) {
+        for (int x = getcurx(stdscr); x < end_x; ++x) {
+            addch(' ');
+        }
+    }
+}
+
+size_t fit_size_from_table_cell(Table_Cell *cell, const char *text, int width)
+{
+    size_t fit_size = 0;
+    if (cell->display_width <= width) {
+        return cell->str_size;
+    }
+    if (COLUMN_MAX_WIDTH == width) {
+        return cell->fit_size;
+    }
+    if (cell->display_width == cell->str_size) {
+        // ASCII
+        return width;
+    }
+    utf8_display_width(text, cell->str_size, width, &fit_size);
+    return fit_size;
+}
+
+// Fit 95% of the cells of a column, so that a few long values do not widen
+// the column for all the rest, but never hide part of the header.
+int column_layout_width(Table_Column *column)
+{
+    size_t fit_size = 0;
+    int width = width_percentile(&column->width_stats, 95);
+    int header_width = utf8_display_width(column->name, strlen(column->name), COLUMN_MAX_WIDTH, &fit_size)
+        + (column->is_pk? 5 : 0)
+        + (NULL != column->fk_table_name? 5 : 0);
+
+    if (width < header_width) width = header_width;
+    if (width < COLUMN_MIN_WIDTH) width = COLUMN_MIN_WIDTH;
+    if (width > COLUMN_MAX_WIDTH) width = COLUMN_MAX_WIDTH;
+    return width;
+}
+
+// Scroll so that the cursor is inside the viewport, and place the columns
+// that fit inside it.
+void layout_table_widget(Table *table, View_Cursor *cursor, Table_Widget_Layout *layout)
+{
+    if (cursor->row < cursor->first_row) {
+        cursor->first_row = cursor->row;
+    } else if (cursor->row >= cursor->first_row + layout->visible_row_count) {
+        cursor->first_row = cursor->row - layout->visible_row_count + 1;
+    }
+
+    if (cursor->col < cursor->first_col) {
+        cursor->first_col = cursor->col;
+    }
+    for (;;) {
+        int x = 0;
+        loop_from (col_idx, cursor->first_col, cursor->col + 1) {
+            x += COLUMN_PADDING + column_layout_width(vec_seek(table->column_vec, col_idx));
+        }
+        if (x <= COLS
+        ||  cursor->first_col == cursor->col
+        ||  cursor->col - cursor->first_col >= TABLE_WIDGET_MAX_VISIBLE_COLS) {
+            break;
+        }
+        ++cursor->first_col;
+    }
+
+    int x = 0;
+    layout->col_layout_hash = cursor->first_col;
+    layout->last_col = cursor->first_col;
+    while (layout->last_col < table->col_count
+    &&     layout->last_col - cursor->first_col < TABLE_WIDGET_MAX_VISIBLE_COLS
+    &&     x < COLS) {
+        int idx = layout->last_col - cursor->first_col;
+        int width = column_layout_width(vec_seek(table->column_vec, layout->last_col));
+        if (x + COLUMN_PADDING + width > COLS) {
+            // Show as much of the last column as fits.
+            width = COLS - x - COLUMN_PADDING;
+            if (width < 1) break;
+        }
+        layout->col_x_arr[idx] = x;
+        layout->col_width_arr[idx] = width;
+        layout->col_layout_hash = layout->col_layout_hash * 31 + width;
+        x += COLUMN_PADDING + width;
+        ++layout->last_col;
+    }
+}
+
+void table_summary_widget(Table *table, int row_count)
+{
+    if (NULL != table->window) {
+        mvprintw(0, 0, "%d columns, rows %d to %d%s.",
+                table->col_count,
+                table->window->row_offset + 1,
+                table->window->row_offset + table->row_count,
+                table->window->is_at_end? " (end)" : "");
+    } else {
+        mvprintw(0, 0, "%d columns, %d rows.", table->col_count, row_count);
+    }
+    clrtoeol();
+}
+
+void table_header_widget(Table *table, View_Cursor *cursor, Table_Widget_Layout *layout)
+{
+    char text_buf[255];
+
+    move(layout->offset, 0);
+    clrtoeol();
+    loop_from (col_idx, cursor->first_col, layout->last_col) {
+        Table_Column *column = (Table_Column *)vec_seek(table->column_vec, col_idx);
+        int idx = col_idx - cursor->first_col;
+        size_t fit_size = 0;
         char pk_symbol[] = "(PK) ";
         char fk_symbol[] = "(FK) ";
         // TODO:
         // - Enable utf8 so that the key symbol can be printed
         //   - u8"🔑";
         //   - "\0x1F511";
+        int len = snprintf(text_buf, sizeof(text_buf), "%s%s%s",
+                column->is_pk? pk_symbol : "",
+                NULL != column->fk_table_name? fk_symbol : "",
+                column->name);
+        utf8_display_width(text_buf, len, layout->col_width_arr[idx], &fit_size);
         attron(A_BOLD);
-            mvprintw(
-                    table_layout.offset,
-                    table_layout.column_width * col_idx,
-                    "  %s%s%s\n",
-                    column->is_pk? pk_symbol : "",
-                    NULL != column->fk_table? fk_symbol : "",
-                    column->name);
+            move(layout->offset, layout->col_x_arr[idx] + COLUMN_PADDING);
+            fixed_width_text_widget(text_buf, fit_size, layout->col_width_arr[idx]);
         attroff(A_BOLD);
+    }
+}
+
+// Draw one row of the table in its place in the viewport.  Rows beyond
+// row_count, which may still be loading, are drawn blank.
+void table_row_widget(Table *table, View_Cursor *cursor, Fk_Lookup *lookup, Table_Widget_Layout *layout, int row_count, int row_idx)
+{
+    char text_buf[255];
+    int y = layout->offset + 1 + row_idx - cursor->first_row;
+    int is_cursor_row = row_idx == cursor->row;
+
+    if (row_idx < cursor->first_row || y > layout->offset + layout->visible_row_count) {
+        return;
+    }
+    move(y, 0);
+    clrtoeol();
+    if (row_idx >= row_count) {
+        return;
+    }
+
+    loop_from (col_idx, cursor->first_col, layout->last_col) {
+        Table_Column *column = (Table_Column *)vec_seek(table->column_vec, col_idx);
+        Table_Cell *cell = (Table_Cell *)vec_seek(column->cell_vec, row_idx);
+        const char *text = cell_text_with_lookup(column, cell, lookup, text_buf, sizeof(text_buf));
+        int idx = col_idx - cursor->first_col;
+        int width = layout->col_width_arr[idx];
+        int x = layout->col_x_arr[idx];
+        size_t fit_size = 0;
+
+        if (text == text_buf) {
+            utf8_display_width(text, strlen(text), width, &fit_size);
+        } else {
+            fit_size = fit_size_from_table_cell(cell, text, width);
+        }
+
+        // Display table cursor.
+        if (is_cursor_row) {
+            attron(COLOR_PAIR(1));
+            mvaddstr(y, x + 1, " ");
+            if (col_idx == cursor->col) attron(A_UNDERLINE);
+        } else {
+            move(y, x + COLUMN_PADDING);
+        }
+        fixed_width_text_widget(text, fit_size, width);
+        attroff(COLOR_PAIR(1) | A_UNDERLINE);
+    }
+}
+
+// Shift the rows in the viewport by line_count, up if it is positive.
+void scroll_table_rows(Table_Widget_Layout *layout, int line_count)
+{
+    int top = layout->offset + 1;
+    int bottom = layout->offset + layout->visible_row_count;
+
+    scrollok(stdscr, TRUE);
+    setscrreg(top, bottom);
+    scrl(line_count);
+    setscrreg(0, LINES - 1);
+    scrollok(stdscr, FALSE);
+}
+
+// Only the rows and columns inside the terminal are drawn, so the cost of a
+// redraw depends on the size of the terminal rather than the table.
+//
+// The widget remembers what it last drew in state.  When only the cursor
+// has moved, just the rows it left and entered are drawn again.  When the
+// viewport has scrolled by less than a screen, the rows already drawn are
+// shifted with scrl and only the rows scrolled into view are drawn.
+// Anything else draws the whole table.  Returns 1 if the whole table was
+// drawn.
+int table_widget(Table *table, View_Cursor *cursor, Table *fk_lookup_table, Table_Widget_State *state)
+{
+    Table_Widget_Layout layout = { .offset = 4 };
+    int row_count = loaded_row_count(table);
+
+    // Leave room for the header above and the status bar below.
+    layout.visible_row_count = LINES - layout.offset - 3;
+    if (layout.visible_row_count < 1) layout.visible_row_count = 1;
+    layout_table_widget(table, cursor, &layout);
+
+    Fk_Lookup lookup = { fk_lookup_table, NULL, NULL, NULL };
+    if (NULL != fk_lookup_table) {
+        Table_Column *fk_column = (Table_Column *)vec_seek(table->column_vec, cursor->col);
+        lookup.key_column = fk_column_from_table(fk_lookup_table, fk_column);
+        lookup.label_column = label_column_from_table(fk_lookup_table);
+        if (NULL != lookup.key_column && NULL != lookup.label_column) {
+            lookup.fk_column = fk_column;
+        }
+    }
+
+    int row_offset = NULL == table->window? 0 : table->window->row_offset;
+    int scroll_count = cursor->first_row - state->cursor.first_row;
+    int is_damaged = table != state->table
+        || fk_lookup_table != state->fk_lookup_table
+        || LINES != state->lines
+        || COLS != state->cols
+        || row_offset != state->row_offset
+        || layout.col_layout_hash != state->col_layout_hash
+        || abs(scroll_count) >= layout.visible_row_count
+        || !row_count || !state->row_count || row_count < state->row_count
+        // Lookups are shown in the cursor's column.
+        || (NULL != fk_lookup_table && cursor->col != state->cursor.col);
 
-        // Display table data.
-        int cell_idx = 0;
-        Vector_Iter *cell_iter = new_vector_iter(column->cell_vec);
-        vec_loop (cell_iter, Table_Cell, cell) {
-            mvprintw(
-                    table_layout.offset + 1 + cell_idx,
-                    table_layout.column_width * col_idx,
-                    "  %s\n",
-                    cell->str_data);
-            ++cell_idx;
-        } delete_vector_iter(cell_iter);
-        ++col_idx;
-    } reset_vector_iter(col_iter);
-
-    // Display table cursor.
-    attron(COLOR_PAIR(1));
-        col_idx = 0;
-        if (table->row_count) {
-            vec_loop (col_iter, Table_Column, column) {
-                cell = (Table_Cell *)vec_seek(column->cell_vec, cursor->row);
-                mvprintw(
-                        table_layout.offset + 1 + cursor->row,
-                        1 + table_layout.column_width * col_idx,
-                        " %s\n",
-                        cell->str_data);
-                ++col_idx;
+    if (is_damaged) {
+        erase();
+        loop_from (row_idx, cursor->first_row, cursor->first_row + layout.visible_row_count) {
+            table_row_widget(table, cursor, &lookup, &layout, row_count, row_idx);
+        }
+        table_summary_widget(table, row_count);
+        table_header_widget(table, cursor, &layout);
+
+        if (!row_count && NULL == table->loader) {
+            attron(A_BOLD);
+                mvprintw(layout.offset + 4, 12, "No records\n");
+            attroff(A_BOLD);
+            mvprintw(layout.offset + 6, 12, "Type 'c' to create a new record\n");
+        }
+    } else {
+        int first_new_row = cursor->first_row;
+        int last_new_row = cursor->first_row;
+        if (scroll_count > 0) {
+            scroll_table_rows(&layout, scroll_count);
+            first_new_row = cursor->first_row + layout.visible_row_count - scroll_count;
+            last_new_row = cursor->first_row + layout.visible_row_count;
+        } else if (scroll_count < 0) {
+            scroll_table_rows(&layout, scroll_count);
+            last_new_row = cursor->first_row - scroll_count;
+        }
+        loop_from (row_idx, first_new_row, last_new_row) {
+            table_row_widget(table, cursor, &lookup, &layout, row_count, row_idx);
+        }
+
+        // Rows loaded since the last draw.
+        if (row_count != state->row_count) {
+            loop_from (row_idx, state->row_count, row_count) {
+                if (row_idx >= cursor->first_row + layout.visible_row_count) break;
+                table_row_widget(table, cursor, &lookup, &layout, row_count, row_idx);
             }
+            table_summary_widget(table, row_count);
         }
-        delete_vector_iter(col_iter);
-    attroff(COLOR_PAIR(1));
 
-    if (!table->row_count) {
-        attron(A_BOLD);
-            mvprintw(table_layout.offset + 4, 12, "No records\n");
-        attroff(A_BOLD);
-        mvprintw(table_layout.offset + 6, 12, "Type 'c' to create a new record\n");
+        table_row_widget(table, cursor, &lookup, &layout, row_count, state->cursor.row);
+        table_row_widget(table, cursor, &lookup, &layout, row_count, cursor->row);
     }
+
+    state->table = table;
+    state->fk_lookup_table = fk_lookup_table;
+    state->cursor = *cursor;
+    state->col_layout_hash = layout.col_layout_hash;
+    state->row_count = row_count;
+    state->row_offset = row_offset;
+    state->lines = LINES;
+    state->cols = COLS;
+    return is_damaged;
 }
 
 void status_bar_widget(char *msg)
 {
-    mvprintw(13, 4, msg);
+    move(LINES - 1, 0);
+    clrtoeol();
+    mvaddnstr(LINES - 1, 4, msg, MAX(COLS - 4, 0));
+}
+
+// Read a line of text typed on the status bar into buf, which holds len
+// bytes.  Returns 1 if the text is entered with Enter, or 0 if it is given
+// up with Escape or Ctrl-C.  Waits for each key, so nothing else is drawn
+// while the text is typed.
+int text_prompt_widget(const char *prompt, char *buf, size_t len)
+{
+    size_t size = strlen(buf);
+    int prompt_width = strlen(prompt);
+    int is_entered = -1;
+
+    nodelay(stdscr, FALSE);
+    while (-1 == is_entered) {
+        // Show as much of the end of the text as fits.
+        int max_width = MAX(COLS - prompt_width - 1, 1);
+        size_t start = 0;
+        size_t fit_size = 0;
+        while (utf8_display_width(buf + start, size - start, max_width, &fit_size) > max_width) {
+            do {
+                ++start;
+            } while ((buf[start] & 0xc0) == 0x80);
+        }
+        mvaddstr(LINES - 1, 0, prompt);
+        addnstr(buf + start, size - start);
+        clrtoeol();
+        refresh();
+
+        int key = getch();
+        switch (key) {
+            case '\n': case '\r': case KEY_ENTER:
+                is_entered = 1;
+                break;
+
+            case 27: case 3:  // Escape and Ctrl-C.
+                is_entered = 0;
+                break;
+
+            case KEY_BACKSPACE: case 127: case 8:
+                // Remove a whole character, with its continuation bytes.
+                while (size > 0 && (buf[--size] & 0xc0) == 0x80);
+                buf[size] = '\0';
+                break;
+
+            default:
+                // Keys other than text are above 255.  UTF-8 comes a byte
+                // at a time.
+                if (key >= ' ' && key < 256 && size + 1 < len) {
+                    buf[size++] = key;
+                    buf[size] = '\0';
+                }
+        }
+    }
+    nodelay(stdscr, TRUE);
+    return is_entered;
+}
+
+// Show lines of text in a box over the view, starting from the end, until a
+// key other than j or k, which scroll the text, is pressed.  The view must
+// be drawn again afterwards.
+void text_overlay_widget(const char *title, const char **line_arr, int line_count)
+{
+    int width = strlen(title) + 4;
+    loop (line_idx, line_count) {
+        width = MAX(width, (int)strlen(line_arr[line_idx]) + 4);
+    }
+    width = MAX(MIN(width, COLS - 2), 8);
+    int height = MAX(MIN(line_count + 2, LINES - 2), 3);
+    int first_line = MAX(line_count - (height - 2), 0);
+    WINDOW *win = newwin(height, width, (LINES - height) / 2, (COLS - width) / 2);
+
+    for (;;) {
+        werase(win);
+        box(win, 0, 0);
+        mvwaddnstr(win, 0, 2, title, width - 4);
+        loop (row, MIN(height - 2, line_count - first_line)) {
+            mvwaddnstr(win, row + 1, 2, line_arr[first_line + row], width - 4);
+        }
+        wrefresh(win);
+
+        int key = wgetch(win);
+        if ('j' == key) {
+            first_line = MIN(first_line + 1, MAX(line_count - (height - 2), 0));
+        } else if ('k' == key) {
+            first_line = MAX(first_line - 1, 0);
+        } else {
+            break;
+        }
+    }
+    delwin(win);
+}
+
+// Show the value of a cell in a box over the view, until a key other than
+// j or k, which scroll a line, or f or b, which scroll a page, is pressed.
+// Lines are read from the value as they come into the box.  The view must be
+// drawn again afterwards.
+void value_overlay_widget(const char *title, Value_Reader *reader)
+{
+    int width = MAX(MIN(COLS - 2, 84), 8);
+    int height = MAX(LINES - 2, 3);
+    int page_line_count = height - 2;
+    int first_line = 0;
+    char line[VALUE_READER_LINE_LEN];
+    WINDOW *win = newwin(height, width, (LINES - height) / 2, (COLS - width) / 2);
+
+    reader->width = width - 4;
+    for (;;) {
+        werase(win);
+        box(win, 0, 0);
+        mvwaddnstr(win, 0, 2, title, width - 4);
+        loop (row, page_line_count) {
+            if (!read_value_line(reader, first_line + row, line)) {
+                break;
+            }
+            mvwaddnstr(win, row + 1, 2, line, width - 4);
+        }
+        wrefresh(win);
+
+        int key = wgetch(win);
+        int step = 'j' == key || 'k' == key? 1 : page_line_count;
+        if ('j' == key || 'f' == key) {
+            // Stop once the last line is in the box.
+            while (step-- && read_value_line(reader, first_line + page_line_count, line)) {
+                ++first_line;
+            }
+        } else if ('k' == key || 'b' == key) {
+            first_line = MAX(first_line - step, 0);
+        } else {
+            break;
+        }
+    }
+    delwin(win);
 }
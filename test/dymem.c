@@ -0,0 +1,281 @@
+{
+    describe("dymem_allocate") {
+        it("starts a new page when the data do not fit in the current one") {
+            Dymem *mem = dymem_init(10);
+            char *a = (char *)dymem_allocate(mem, 6);
+            char *b = (char *)dymem_allocate(mem, 6);
+            char *c = (char *)dymem_allocate(mem, 20);
+            expect_ptr_eq(a, mem->first_page->data);
+            expect_ptr_eq(b, mem->first_page->next->data);
+            expect_ptr_eq(c, mem->page_cursor->data);
+            expect_int_eq(mem->page_count, 3);
+            dymem_free(mem);
+        } tested;
+    } tested;
+
+    describe("dymem_init_growing") {
+        it("doubles the size of each new page up to the maximum") {
+            Dymem *mem = dymem_init_growing(NULL, 10, 40);
+            loop (idx, 10) {
+                dymem_allocate(mem, 10);
+            }
+            int sizes[] = { 10, 20, 40, 40 };
+            int idx = 0;
+            for (Memory_Page *page = mem->first_page; idx < 4; page = page->next, ++idx) {
+                expect_int_eq(page->size, sizes[idx]);
+            }
+            dymem_free(mem);
+        } tested;
+    } tested;
+
+    describe("dymem_append") {
+        it("moves the pages of one arena to the end of another") {
+            Dymem *mem = dymem_init(10);
+            Dymem *src = dymem_init(10);
+            char *a = (char *)dymem_allocate(mem, 8);
+            char *b = (char *)dymem_allocate(src, 8);
+            char *c = (char *)dymem_allocate(src, 8);
+            strcpy(b, "kept");
+
+            dymem_append(mem, src);
+            expect_int_eq(mem->page_count, 3);
+            expect_int_eq(src->page_count, 0);
+            expect_ptr_eq(mem->first_page->data, a);
+            expect_ptr_eq(mem->first_page->next->data, b);
+            expect_ptr_eq(mem->page_cursor->data, c);
+            expect_str_eq(b, "kept");
+
+            dymem_free(src);
+            dymem_free(mem);
+        } tested;
+    } tested;
+
+    describe("dymem_rewind") {
+        it("releases the memory allocated after the mark") {
+            Dymem *mem = dymem_init(10);
+            dymem_allocate(mem, 4);
+            Dymem_Mark mark = dymem_mark(mem);
+            char *a = (char *)dymem_allocate(mem, 4);
+            dymem_allocate(mem, 8);
+            dymem_allocate(mem, 8);
+            expect_int_eq(mem->page_count, 3);
+
+            dymem_rewind(mem, mark);
+            expect_int_eq(mem->page_count, 1);
+            expect_ptr_eq(a, dymem_allocate(mem, 4));
+            dymem_free(mem);
+        } tested;
+
+        it("releases every page when rewound to a mark taken before allocation") {
+            Dymem *mem = dymem_init(10);
+            Dymem_Mark mark = dymem_mark(mem);
+            dymem_allocate(mem, 8);
+            dymem_allocate(mem, 8);
+
+            dymem_rewind(mem, mark);
+            expect_int_eq(mem->page_count, 0);
+            expect_ptr_eq(NULL, mem->first_page);
+            dymem_free(mem);
+        } tested;
+    } tested;
+
+    describe("dymem counters") {
+        it("count the bytes requested, held and left at the ends of pages") {
+            Dymem *mem = dymem_init(10);
+            dymem_allocate(mem, 6);
+            dymem_allocate(mem, 6);
+            dymem_allocate(mem, 3);
+            expect_int_eq(mem->requested_bytes, 15);
+            expect_int_eq(mem->reserved_bytes, 20);
+            expect_int_eq(mem->tail_waste_bytes, 4);
+            expect_int_eq(mem->peak_bytes, 20);
+            dymem_free(mem);
+        } tested;
+
+        it("are restored by a rewind, except for the peak") {
+            Dymem *mem = dymem_init(10);
+            dymem_allocate(mem, 4);
+            Dymem_Mark mark = dymem_mark(mem);
+            dymem_allocate(mem, 8);
+            dymem_allocate(mem, 8);
+
+            dymem_rewind(mem, mark);
+            expect_int_eq(mem->requested_bytes, 4);
+            expect_int_eq(mem->reserved_bytes, 10);
+            expect_int_eq(mem->tail_waste_bytes, 0);
+            expect_int_eq(mem->peak_bytes, 30);
+            dymem_free(mem);
+        } tested;
+
+        it("are moved by dymem_append") {
+            Dymem *mem = dymem_init(10);
+            Dymem *src = dymem_init(10);
+            dymem_allocate(mem, 8);
+            dymem_allocate(src, 8);
+            dymem_allocate(src, 8);
+
+            dymem_append(mem, src);
+            expect_int_eq(mem->requested_bytes, 24);
+            expect_int_eq(mem->reserved_bytes, 30);
+            expect_int_eq(mem->tail_waste_bytes, 4);
+            expect_int_eq(src->reserved_bytes, 0);
+            dymem_free(src);
+            dymem_free(mem);
+        } tested;
+    } tested;
+
+    describe("page_pool") {
+        it("shares released pages between arenas") {
+            Page_Pool pool;
+            init_page_pool(&pool, 100);
+            Dymem *mem_a = dymem_init_in_page_pool(&pool, 10);
+            Dymem *mem_b = dymem_init_in_page_pool(&pool, 10);
+
+            char *a = (char *)dymem_allocate(mem_a, 8);
+            dymem_free(mem_a);
+            expect_int_eq(pool.free_page_count, 1);
+
+            expect_ptr_eq(a, dymem_allocate(mem_b, 8));
+            expect_int_eq(pool.free_page_count, 0);
+
+            dymem_free(mem_b);
+            drain_page_pool(&pool);
+        } tested;
+
+        it("frees pages once the pool holds max_free_bytes") {
+            Page_Pool pool;
+            init_page_pool(&pool, 15);
+            Dymem *mem = dymem_init_in_page_pool(&pool, 10);
+            dymem_allocate(mem, 8);
+            dymem_allocate(mem, 8);
+            dymem_free(mem);
+            expect_int_eq(pool.free_page_count, 1);
+            drain_page_pool(&pool);
+        } tested;
+
+        it("recycles the pages of a deleted vector") {
+            Page_Pool pool;
+            init_page_pool(&pool, MB(1));
+            Vector *vec = new_vector_in_page_pool(&pool, sizeof(int), 10, 1);
+            loop (idx, 100) {
+                vec_push(vec, &idx);
+            }
+            int page_count = vec->page_count;
+            delete_vector(vec);
+            expect_int_eq(pool.free_page_count, page_count);
+
+            vec = new_vector_in_page_pool(&pool, sizeof(int), 10, 1);
+            loop (idx, 100) {
+                vec_push(vec, &idx);
+            }
+            expect_int_eq(pool.free_page_count, 0);
+            delete_vector(vec);
+            drain_page_pool(&pool);
+        } tested;
+    } tested;
+
+    describe("spill file") {
+        Page_Pool pool;
+        init_page_pool(&pool, 0);
+
+        it("backs the large pages of a pool") {
+            expect_int_eq(open_page_pool_spill_file(&pool, "/tmp"), 0);
+            Memory_Page *small = take_mem_page(&pool, KB(1));
+            Memory_Page *large = take_mem_page(&pool, KB(100));
+            expect_int_eq(small->spill_offset, -1);
+            expect_int_eq(large->spill_offset, 0);
+            release_mem_page(&pool, small);
+            release_mem_page(&pool, large);
+        } tested;
+
+        it("pages out the data of a dymem, and reads them back") {
+            Dymem *mem = dymem_init_in_page_pool(&pool, KB(100));
+            char *a = (char *)dymem_allocate(mem, KB(60));
+            char *b = (char *)dymem_allocate(mem, KB(30));
+            memset(a, 'a', KB(60));
+            memset(b, 'b', KB(30));
+
+            page_out_dymem(mem);
+            size_t spilled_bytes = mem->spilled_bytes;
+            expect_int_eq(spilled_bytes > KB(80), 1);
+            expect_int_eq(spilled_bytes, mem->first_page->paged_out_size);
+            page_out_dymem(mem);
+            expect_int_eq(mem->spilled_bytes, spilled_bytes);
+
+            char *c = (char *)dymem_allocate(mem, KB(60));
+            memset(c, 'c', KB(60));
+            page_out_dymem(mem);
+            expect_int_eq(mem->spilled_bytes > spilled_bytes + KB(50), 1);
+            expect_int_eq(a[KB(60) - 1], 'a');
+            expect_int_eq(b[KB(30) - 1], 'b');
+            expect_int_eq(c[0], 'c');
+
+            Dymem_Mark empty_mark = { 0 };
+            dymem_rewind(mem, empty_mark);
+            expect_int_eq(mem->spilled_bytes, 0);
+            dymem_free(mem);
+        } tested;
+
+        it("pages out the elements of a vector") {
+            Vector *vec = new_vector_in_page_pool(&pool, sizeof(int), 20000, 0);
+            loop (idx, 50000) {
+                vec_push(vec, &idx);
+            }
+            page_out_vector(vec);
+            expect_int_eq(vec->spilled_bytes > 45000 * sizeof(int), 1);
+            expect_int_eq(*(int *)vec_seek(vec, 12345), 12345);
+
+            vec_clear(vec);
+            expect_int_eq(vec->spilled_bytes, 0);
+            delete_vector(vec);
+        } tested;
+
+        close_page_pool_spill_file(&pool);
+    } tested;
+
+    describe("dymem_allocate_aligned") {
+        it("aligns data that follow unaligned allocations") {
+            Dymem *mem = dymem_init(64);
+            dymem_allocate(mem, 3);
+            double *d = (double *)dymem_allocate_aligned(mem, sizeof(double), _Alignof(double));
+            expect_int_eq((uintptr_t)d % _Alignof(double), 0);
+            dymem_allocate(mem, 1);
+            char *line = (char *)dymem_allocate_aligned(mem, 16, 64);
+            expect_int_eq((uintptr_t)line % 64, 0);
+            dymem_free(mem);
+        } tested;
+    } tested;
+
+    describe("new_mem_page") {
+        it("aligns the data of small and large pages") {
+            Memory_Page *small = new_mem_page(100);
+            Memory_Page *large = new_mem_page(MB(2));
+            expect_int_eq((uintptr_t)small->data % _Alignof(max_align_t), 0);
+            expect_int_eq((uintptr_t)large->data % _Alignof(max_align_t), 0);
+            expect_int_eq(small->map_size, 0);
+            expect_int_eq(large->map_size >= MEM_PAGE_HEADER_SIZE + MB(2), 1);
+            large->data[MB(2) - 1] = 'x';
+            free_mem_page(small);
+            free_mem_page(large);
+        } tested;
+
+        it("maps a page of a whole number of huge pages without rounding up") {
+            Memory_Page *page = new_mem_page(HUGE_PAGE_SIZE);
+            expect_int_eq(page->map_size, HUGE_PAGE_SIZE);
+            expect_int_eq((uintptr_t)page->data % HUGE_PAGE_SIZE, 0);
+            expect_int_eq(mem_page_mapped_size(page), HUGE_PAGE_SIZE + MEM_PAGE_HEADER_SIZE);
+            page->data[HUGE_PAGE_SIZE - 1] = 'x';
+            discard_mem_page_data(page);
+            expect_int_eq(page->data[HUGE_PAGE_SIZE - 1], 0);
+            free_mem_page(page);
+        } tested;
+
+        it("counts the memory the pages of a dymem take") {
+            Dymem *mem = dymem_init(100);
+            dymem_allocate(mem, 100);
+            dymem_allocate(mem, HUGE_PAGE_SIZE);
+            expect_int_eq(mem->mapped_bytes, 2 * MEM_PAGE_HEADER_SIZE + 100 + HUGE_PAGE_SIZE);
+            dymem_free(mem);
+        } tested;
+    } tested;
+}
@@ -0,0 +1,70 @@
+{
+    describe("push_key_into_event_queue") {
+        Event_Queue queue = { 0 };
+        Event event;
+
+        it("merges repeated movements into one") {
+            loop (idx, 5) {
+                push_key_into_event_queue(&queue, 'j');
+            }
+            push_key_into_event_queue(&queue, 'k');
+            expect_int_eq(queue.count, 2);
+            pop_event(&queue, &event);
+            expect_int_eq(event.id, UI_EVENT_CURSOR_DOWN);
+            expect_int_eq(event.data_as_int, 5);
+            pop_event(&queue, &event);
+            expect_int_eq(event.id, UI_EVENT_CURSOR_UP);
+            expect_int_eq(event.data_as_int, 1);
+            expect_int_eq(pop_event(&queue, &event), 0);
+        } tested;
+
+        it("moves by the count typed before the key") {
+            push_key_into_event_queue(&queue, '5');
+            push_key_into_event_queue(&queue, '0');
+            push_key_into_event_queue(&queue, '0');
+            push_key_into_event_queue(&queue, 'j');
+            push_key_into_event_queue(&queue, 'j');
+            pop_event(&queue, &event);
+            expect_int_eq(event.data_as_int, 501);
+        } tested;
+
+        it("goes to the first row on gg and the last on G") {
+            push_key_into_event_queue(&queue, 'g');
+            expect_int_eq(queue.count, 0);
+            push_key_into_event_queue(&queue, 'g');
+            pop_event(&queue, &event);
+            expect_int_eq(event.id, UI_EVENT_CURSOR_GOTO_ROW);
+            expect_int_eq(event.data_as_int, 0);
+            push_key_into_event_queue(&queue, 'G');
+            pop_event(&queue, &event);
+            expect_int_eq(event.data_as_int, EVENT_LAST_ROW);
+            push_key_into_event_queue(&queue, '2');
+            push_key_into_event_queue(&queue, '0');
+            push_key_into_event_queue(&queue, 'G');
+            pop_event(&queue, &event);
+            expect_int_eq(event.data_as_int, 19);
+        } tested;
+
+        it("passes other keys on as key presses") {
+            push_key_into_event_queue(&queue, '3');
+            push_key_into_event_queue(&queue, 'q');
+            pop_event(&queue, &event);
+            expect_int_eq(event.id, UI_EVENT_KEY_PRESS);
+            expect_char_eq(event.data_as_char, 'q');
+            expect_int_eq(queue.key_count, 0);
+        } tested;
+
+        it("keeps the order of events across the end of the buffer") {
+            loop (idx, EVENT_QUEUE_SIZE) {
+                push_key_into_event_queue(&queue, idx % 2? 'l' : 'h');
+            }
+            expect_int_eq(push_event(&queue, plain_event(UI_EVENT_CURSOR_LEFT)), 0);
+            loop (idx, EVENT_QUEUE_SIZE) {
+                pop_event(&queue, &event);
+                if (event.id != (idx % 2? UI_EVENT_CURSOR_RIGHT : UI_EVENT_CURSOR_LEFT)) break;
+            }
+            expect_int_eq(event.id, UI_EVENT_CURSOR_RIGHT);
+            expect_int_eq(queue.count, 0);
+        } tested;
+    } tested;
+}
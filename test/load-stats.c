@@ -0,0 +1,91 @@
+{
+    describe("load stats") {
+        Table_Pool pool;
+        Table *table = NULL;
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table item (id integer primary key, code text);"
+                "insert into item (code) values ('ab'), ('cd'), (null);",
+                NULL, NULL, NULL);
+
+        it("counts the rows and bytes of a load") {
+            new_table_with_query_using_sqlite(&table, "Items", "select id, code from item;");
+            expect_int_eq(table->load_stats.is_done, 1);
+            expect_int_eq(table->load_stats.row_count, 3);
+            // Three integers, and two strings of two bytes with their NULs.
+            expect_int_eq(table->load_stats.bytes_copied, 3 * 8 + 2 * 3);
+            expect_int_eq(table->load_stats.page_count > 0, 1);
+        } tested;
+
+        it("explains the plan of the statement the table was loaded with") {
+            char line_arr[QUERY_PLAN_MAX_STEPS][SESSION_LOG_LINE_LEN];
+            expect_int_eq(explain_query_plan_using_sqlite(
+                        global_app_state.db, table->sql, line_arr, QUERY_PLAN_MAX_STEPS), 1);
+            expect_str_eq(line_arr[0], "SCAN item");
+            expect_int_eq(explain_query_plan_using_sqlite(
+                        global_app_state.db, "selec", line_arr, QUERY_PLAN_MAX_STEPS), -1);
+        } tested;
+
+        it("adds up the memory of the table and of the pool") {
+            Memory_Stats stats = memory_stats_from_table(table);
+            Memory_Stats total = memory_stats_from_table_pool(&pool);
+            expect_int_eq(stats.requested_bytes >= table->load_stats.bytes_copied, 1);
+            expect_int_eq(stats.reserved_bytes >= stats.requested_bytes + stats.tail_waste_bytes, 1);
+            expect_int_eq(total.reserved_bytes > stats.reserved_bytes, 1);
+            expect_int_eq(total.page_count > stats.page_count, 1);
+        } tested;
+
+        it("writes the memory of each table as tab separated values") {
+            char *dump = NULL;
+            size_t dump_size = 0;
+            FILE *file = open_memstream(&dump, &dump_size);
+            write_memory_stats(&pool, file);
+            fclose(file);
+            expect_int_eq(0 == strncmp(dump, "table\trefs\trows\tpages\t", 22), 1);
+            expect_int_eq(NULL != strstr(dump, "\nItems\t1\t3\t"), 1);
+            expect_int_eq(NULL != strstr(dump, "\n*total*\t"), 1);
+            free(dump);
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+
+    describe("lines_from_session_log") {
+        Session_Log log = { 0 };
+        const char *line_ptr_arr[SESSION_LOG_MAX_LINES];
+
+        it("keeps the most recent lines, oldest first") {
+            loop (line_idx, SESSION_LOG_MAX_LINES + 2) {
+                sprintf(log.line_arr[log.line_count++ & (SESSION_LOG_MAX_LINES - 1)], "%d", line_idx);
+            }
+            expect_int_eq(lines_from_session_log(&log, line_ptr_arr), SESSION_LOG_MAX_LINES);
+            expect_str_eq(line_ptr_arr[0], "2");
+            expect_str_eq(line_ptr_arr[SESSION_LOG_MAX_LINES - 1], "257");
+        } tested;
+    } tested;
+
+    describe("load timer") {
+        Load_Timer timer;
+        Load_Stats stats = { 0 };
+
+        it("samples one row in every LOAD_TIMER_SAMPLE_INTERVAL") {
+            int sample_count = 0;
+            start_load_timer(&timer);
+            loop (row_idx, 2 * LOAD_TIMER_SAMPLE_INTERVAL) {
+                int is_sampled = begin_load_timer_row(&timer);
+                sample_count += is_sampled;
+                end_load_timer_row(&timer, is_sampled);
+            }
+            expect_int_eq(sample_count, 2);
+        } tested;
+
+        it("estimates the copy time of every row from the samples") {
+            timer = (Load_Timer){ .start_ns = monotonic_ns() - 1000000000, .sample_copy_ns = 100,
+                                  .sample_count = 2, .row_count = 128 };
+            flush_load_timer(&timer, &stats);
+            expect_int_eq(stats.copy_ns, 6400);
+            expect_int_eq(stats.step_ns >= 1000000000 - 6400, 1);
+            expect_int_eq(timer.row_count, 0);
+        } tested;
+    } tested;
+}
\ No newline at end of file
@@ -2,10 +2,49 @@
 
 #include "test.h"
 
+// Open a table pool and a database, at path or ":memory:", as the app's.  A
+// database file is removed first, so that each run starts afresh.
+void setup_pool_db(Table_Pool *pool, const char *path)
+{
+    if (0 != strcmp(path, ":memory:")) {
+        remove(path);
+    }
+    init_table_pool(pool);
+    global_table_pool = pool;
+    sqlite3_open(path, &global_app_state.db);
+}
+
+// Free what setup_pool_db opened, removing the database file if there is one.
+void teardown_pool_db(Table_Pool *pool)
+{
+    char path[PATH_MAX] = "";
+    const char *filename = sqlite3_db_filename(global_app_state.db, "main");
+    if (NULL != filename) {
+        snprintf(path, sizeof(path), "%s", filename);
+    }
+    free_table_pool(pool);
+    clear_schema_catalog(&global_schema_catalog);
+    clear_stmt_cache(&global_stmt_cache);
+    sqlite3_close(global_app_state.db);
+    global_app_state.db = NULL;
+    global_table_pool = NULL;
+    if ('\0' != *path) {
+        remove(path);
+    }
+}
+
 int main()
 {
 
 #include "vector.c"
+#include "dymem.c"
+#include "util.c"
+#include "event-queue.c"
+#include "stmt-cache.c"
+#include "schema-catalog.c"
+#include "table-pool.c"
+#include "value-reader.c"
+#include "load-stats.c"
 #include "cyaml.c"
 
     return 0;
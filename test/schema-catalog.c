@@ -0,0 +1,69 @@
+{
+    describe("refresh_schema_catalog_using_sqlite") {
+        Schema_Catalog catalog = { 0 };
+        sqlite3 *db = NULL;
+        sqlite3_open(":memory:", &db);
+        sqlite3_exec(db,
+                "create table team (id integer primary key, name text not null);"
+                "create table member (id integer primary key,"
+                "    team_id integer references Team,"
+                "    boss_id integer references member(id) references team(id));"
+                "create view member_view as select * from member;"
+                "create table tag (name text primary key) without rowid;",
+                NULL, NULL, NULL);
+
+        it("reads every table and view in the schema") {
+            expect_int_eq(refresh_schema_catalog_using_sqlite(&catalog, db), 0);
+            expect_int_eq(NULL != table_from_schema_catalog(&catalog, "team"), 1);
+            expect_int_eq(NULL != table_from_schema_catalog(&catalog, "member_view"), 1);
+            expect_ptr_eq(table_from_schema_catalog(&catalog, "nothing"), NULL);
+        } tested;
+
+        it("finds tables by name regardless of case") {
+            expect_ptr_eq(
+                    table_from_schema_catalog(&catalog, "MEMBER"),
+                    table_from_schema_catalog(&catalog, "member"));
+        } tested;
+
+        it("records which tables have a rowid") {
+            expect_int_eq(table_from_schema_catalog(&catalog, "team")->has_rowid, 1);
+            expect_int_eq(table_from_schema_catalog(&catalog, "tag")->has_rowid, 0);
+            expect_int_eq(table_from_schema_catalog(&catalog, "member_view")->has_rowid, 0);
+        } tested;
+
+        it("records the columns of each table in order") {
+            Catalog_Table *table = table_from_schema_catalog(&catalog, "team");
+            expect_int_eq(table->col_count, 2);
+            Catalog_Column *column = column_from_catalog_table(&catalog, table, 1);
+            expect_str_eq(column->name, "name");
+            expect_int_eq(column->is_not_null, 1);
+            expect_int_eq(column_from_catalog_table(&catalog, table, 0)->is_pk, 1);
+        } tested;
+
+        it("records the first foreign key of each column") {
+            Catalog_Table *table = table_from_schema_catalog(&catalog, "member");
+            expect_int_eq(table->col_count, 3);
+            Catalog_Column *column = column_from_catalog_table(&catalog, table, 1);
+            expect_str_eq(column->fk_table_name, "Team");
+            expect_ptr_eq(column->fk_column_name, NULL);
+            column = column_from_catalog_table(&catalog, table, 2);
+            expect_str_eq(column->fk_table_name, "member");
+            expect_str_eq(column->fk_column_name, "id");
+            expect_ptr_eq(column_from_catalog_table(&catalog, table, 0)->fk_table_name, NULL);
+        } tested;
+
+        it("is read again when the schema changes") {
+            Dymem *names = catalog.dymem_names;
+            refresh_schema_catalog_using_sqlite(&catalog, db);
+            expect_ptr_eq(catalog.dymem_names, names);
+
+            sqlite3_exec(db, "create table extra (x);", NULL, NULL, NULL);
+            refresh_schema_catalog_using_sqlite(&catalog, db);
+            expect_int_eq(NULL != table_from_schema_catalog(&catalog, "extra"), 1);
+        } tested;
+
+        clear_schema_catalog(&catalog);
+        clear_stmt_cache(&global_stmt_cache);
+        sqlite3_close(db);
+    } tested;
+}
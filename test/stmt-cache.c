@@ -0,0 +1,46 @@
+{
+    describe("prepare_stmt_from_stmt_cache") {
+        Stmt_Cache cache = { 0 };
+        sqlite3 *db = NULL;
+        sqlite3_open(":memory:", &db);
+
+        it("reuses the statement prepared for the same SQL") {
+            sqlite3_stmt *first = NULL;
+            sqlite3_stmt *second = NULL;
+            prepare_stmt_from_stmt_cache(&cache, db, &first, "select ?1;");
+            release_stmt_from_stmt_cache(&cache, first);
+            prepare_stmt_from_stmt_cache(&cache, db, &second, "select ?1;");
+            expect_ptr_eq(first, second);
+            expect_int_eq(cache.entry_count, 1);
+            release_stmt_from_stmt_cache(&cache, second);
+        } tested;
+
+        it("prepares another statement while the cached one is in use") {
+            sqlite3_stmt *first = NULL;
+            sqlite3_stmt *second = NULL;
+            prepare_stmt_from_stmt_cache(&cache, db, &first, "select ?1;");
+            prepare_stmt_from_stmt_cache(&cache, db, &second, "select ?1;");
+            expect_int_eq(first != second, 1);
+            expect_int_eq(cache.entry_count, 2);
+            release_stmt_from_stmt_cache(&cache, first);
+            release_stmt_from_stmt_cache(&cache, second);
+        } tested;
+
+        it("resets the statement and clears its bindings on release") {
+            sqlite3_stmt *stmt = NULL;
+            prepare_stmt_from_stmt_cache(&cache, db, &stmt, "select ?1;");
+            sqlite3_bind_int(stmt, 1, 42);
+            sqlite3_step(stmt);
+            expect_int_eq(sqlite3_column_int(stmt, 0), 42);
+            release_stmt_from_stmt_cache(&cache, stmt);
+
+            prepare_stmt_from_stmt_cache(&cache, db, &stmt, "select ?1;");
+            expect_int_eq(sqlite3_step(stmt), SQLITE_ROW);
+            expect_int_eq(sqlite3_column_type(stmt, 0), SQLITE_NULL);
+            release_stmt_from_stmt_cache(&cache, stmt);
+        } tested;
+
+        clear_stmt_cache(&cache);
+        sqlite3_close(db);
+    } tested;
+}
@@ -0,0 +1,574 @@
+{
+    describe("find_table_from_table_pool") {
+        Table_Pool pool;
+        Table *table = NULL;
+        Table *cached = NULL;
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table fruit (id integer primary key, name text);"
+                "insert into fruit (name) values ('apple'), ('pear');",
+                NULL, NULL, NULL);
+
+        it("reuses a table that is still loaded") {
+            new_table_with_data_using_sqlite(&table, "fruit");
+            new_table_with_data_using_sqlite(&cached, "fruit");
+            expect_ptr_eq(table, cached);
+            expect_int_eq(table->ref_count, 2);
+            unref_table_from_table_pool(&pool, cached);
+        } tested;
+
+        it("keeps a table that is no longer referenced") {
+            unref_table_from_table_pool(&pool, table);
+            expect_int_eq(table->ref_count, 0);
+            expect_int_eq(NULL != table->data_mem, 1);
+            new_table_with_data_using_sqlite(&cached, "fruit");
+            expect_ptr_eq(table, cached);
+            expect_int_eq(pool.table_count, 1);
+        } tested;
+
+        it("does not reuse a table after the database has changed") {
+            sqlite3_exec(global_app_state.db,
+                    "insert into fruit (name) values ('plum');",
+                    NULL, NULL, NULL);
+            new_table_with_data_using_sqlite(&table, "fruit");
+            expect_int_eq(table != cached, 1);
+            expect_int_eq(table->row_count, 3);
+            expect_ptr_eq(cached->cache_key, NULL);
+            unref_table_from_table_pool(&pool, cached);
+            expect_int_eq(pool.table_count, 1);
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("new_table_with_data_using_sqlite") {
+        Table_Pool pool;
+        Table *table = NULL;
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table person (id integer primary key, name text,"
+                "    manager_id integer references person(id),"
+                "    team_id integer references team);"
+                "create table team (id integer primary key,"
+                "    lead_id integer references person(id));"
+                "insert into team values (7, 1);"
+                "insert into person values (1, 'ada', null, 7), (2, 'bob', 1, 7);",
+                NULL, NULL, NULL);
+
+        it("does not load the tables that foreign keys refer to") {
+            new_table_with_data_using_sqlite(&table, "person");
+            expect_int_eq(pool.table_count, 1);
+            Table_Column *column = column_by_name_from_table(table, "manager_id");
+            expect_str_eq(column->fk_table_name, "person");
+            expect_str_eq(column->fk_column_name, "id");
+            column = column_by_name_from_table(table, "team_id");
+            expect_str_eq(column->fk_table_name, "team");
+            expect_ptr_eq(column->fk_column_name, NULL);
+        } tested;
+
+        it("finds the column a foreign key refers to") {
+            Table_Column *column = column_by_name_from_table(table, "team_id");
+            expect_ptr_eq(fk_column_from_table(table, column), column_by_name_from_table(table, "id"));
+            expect_ptr_eq(label_column_from_table(table), column_by_name_from_table(table, "name"));
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("row_from_column_index") {
+        Table_Pool pool;
+        Table *table = NULL;
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table item (id integer primary key, code text);"
+                "insert into item (code) values ('a'), ('42'), (null), ('a');",
+                NULL, NULL, NULL);
+        new_table_with_data_using_sqlite(&table, "item");
+        Table_Column *id_column = column_by_name_from_table(table, "id");
+        Table_Column *code_column = column_by_name_from_table(table, "code");
+
+        it("finds the row holding a value") {
+            Table_Cell *key = (Table_Cell *)vec_seek(id_column->cell_vec, 2);
+            expect_int_eq(row_from_column_index(table, id_column, id_column, key), 2);
+            expect_int_eq(id_column->index->row_count, 4);
+        } tested;
+
+        it("finds the first of several rows holding a value") {
+            Table_Cell *key = (Table_Cell *)vec_seek(code_column->cell_vec, 3);
+            expect_int_eq(row_from_column_index(table, code_column, code_column, key), 0);
+        } tested;
+
+        it("matches an integer with text that reads as the same integer") {
+            Table_Cell key = { .type = DYTYPE_INT, .str_data = NULL, .data_as_int = 42 };
+            expect_int_eq(row_from_column_index(table, code_column, id_column, &key), 1);
+        } tested;
+
+        it("never matches NULL") {
+            Table_Cell *key = (Table_Cell *)vec_seek(code_column->cell_vec, 2);
+            expect_int_eq(row_from_column_index(table, code_column, code_column, key), -1);
+        } tested;
+
+        it("is dropped when the rows are cleared") {
+            clear_table_rows(table);
+            expect_ptr_eq(id_column->index, NULL);
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("seek_table_cursor_to_row") {
+        Table_Pool pool;
+        Table *table = NULL;
+        View_Cursor cursor = { 0 };
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table entry (id integer primary key, n int);"
+                "with recursive n(i) as (select 1 union all select i + 1 from n where i < 5000)"
+                "  insert into entry (n) select i from n;",
+                NULL, NULL, NULL);
+        new_table_with_data_using_sqlite(&table, "entry");
+        Table_Column *n_column = column_by_name_from_table(table, "n");
+
+        it("loads the last window for the last row") {
+            seek_table_cursor_to_row(table, &cursor, INT_MAX);
+            Table_Cell *cell = (Table_Cell *)vec_seek(n_column->cell_vec, cursor.row);
+            expect_int_eq(table->window->is_at_end, 1);
+            expect_int_eq(table->window->row_offset, 5000 - TABLE_WINDOW_SIZE);
+            expect_int_eq(cursor.row, TABLE_WINDOW_SIZE - 1);
+            expect_int_eq(cell->data_as_int, 5000);
+        } tested;
+
+        it("does not load the window again moving past the last row") {
+            // A load would overwrite the cell.
+            Table_Cell *cell = (Table_Cell *)vec_seek(n_column->cell_vec, cursor.row);
+            cell->data_as_int = -1;
+            seek_table_cursor_to_row(table, &cursor, table_row_from_cursor(table, &cursor) + 1);
+            expect_int_eq(cursor.row, TABLE_WINDOW_SIZE - 1);
+            expect_int_eq(table->window->row_offset, 5000 - TABLE_WINDOW_SIZE);
+            expect_int_eq(cell->data_as_int, -1);
+        } tested;
+
+        unref_table_from_table_pool(&pool, table);
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("seek_table_window_to_key_using_sqlite") {
+        Table_Pool pool;
+        Table *parent = NULL;
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table parent (id integer primary key, name text);"
+                "with recursive n(i) as (select 1 union all select i + 1 from n where i < 5000)"
+                "  insert into parent (name) select 'name' || i from n;",
+                NULL, NULL, NULL);
+        new_table_with_data_using_sqlite(&parent, "parent");
+        Table_Column *id_column = column_by_name_from_table(parent, "id");
+        Table_Column *name_column = column_by_name_from_table(parent, "name");
+        Table_Cell key = { .type = DYTYPE_INT, .str_data = NULL, .data_as_int = 4000 };
+        char label[64];
+
+        it("reads the label of a row beyond the window from the db") {
+            expect_int_eq(row_from_column_index(parent, id_column, id_column, &key), -1);
+            expect_int_eq(label_from_table_using_sqlite(
+                    parent, id_column, name_column, id_column, &key, label, sizeof(label)), 1);
+            expect_str_eq(label, "name4000");
+        } tested;
+
+        it("loads the window around a row beyond it") {
+            int row = seek_table_window_to_key_using_sqlite(parent, id_column, id_column, &key);
+            Table_Cell *cell = (Table_Cell *)vec_seek(id_column->cell_vec, row);
+            expect_int_eq(cell->data_as_int, 4000);
+            expect_int_eq(parent->window->row_offset + row, 3999);
+            expect_int_eq(row_from_column_index(parent, id_column, id_column, &key), row);
+        } tested;
+
+        it("finds no row for a key that is not in the table") {
+            Table_Cell missing = { .type = DYTYPE_INT, .str_data = NULL, .data_as_int = 9999 };
+            expect_int_eq(seek_table_window_to_key_using_sqlite(parent, id_column, id_column, &missing), -1);
+            expect_int_eq(label_from_table_using_sqlite(
+                    parent, id_column, name_column, id_column, &missing, label, sizeof(label)), 0);
+        } tested;
+
+        unref_table_from_table_pool(&pool, parent);
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("new_table_with_console_query_using_sqlite") {
+        Table_Pool pool;
+        Table *table = NULL;
+        char err_buf[255] = "";
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table item (id integer primary key, code text);"
+                "insert into item (code) values ('a'), ('b'), ('c');",
+                NULL, NULL, NULL);
+
+        it("loads the rows of a query, up to the row limit") {
+            expect_int_eq(new_table_with_console_query_using_sqlite(
+                        &table, "select code from item", 2, err_buf, sizeof(err_buf)), 0);
+            expect_int_eq(table->row_count, 2);
+            expect_ptr_eq((void *)table->cache_key, NULL);
+            unref_table_from_table_pool(&pool, table);
+            expect_int_eq(pool.table_count, 0);
+        } tested;
+
+        it("does not run statements that write") {
+            expect_int_eq(new_table_with_console_query_using_sqlite(
+                        &table, "delete from item", 0, err_buf, sizeof(err_buf)), SQLITE_READONLY);
+            expect_int_eq(new_table_with_console_query_using_sqlite(
+                        &table, "select 1; delete from item", 0, err_buf, sizeof(err_buf)), SQLITE_MISUSE);
+            expect_int_eq(pool.table_count, 0);
+        } tested;
+
+        it("reports errors in the SQL") {
+            expect_int_eq(new_table_with_console_query_using_sqlite(
+                        &table, "selec 1", 0, err_buf, sizeof(err_buf)), SQLITE_ERROR);
+            expect_str_eq(err_buf, "Error: near \"selec\": syntax error");
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("start_table_loader_using_sqlite") {
+        const char *sql = "with recursive n(i) as (select 1 union all select i + 1 from n where i < 1000000)"
+                          " select i, 'row ' || i from n";
+        Table_Pool pool;
+        Table *table = NULL;
+        char err_buf[255] = "";
+        setup_pool_db(&pool, "/tmp/sqlite-view-loader-test.db");
+        sqlite3_exec(global_app_state.db, "create table item (id integer primary key);", NULL, NULL, NULL);
+
+        it("publishes the rows while they load, then every row") {
+            new_table_with_console_query_using_sqlite(&table, sql, 0, err_buf, sizeof(err_buf));
+            expect_int_eq(NULL != table->loader, 1);
+            // Count the batches seen before the last rows are published.
+            int seen_count = 0;
+            int grow_count = 0;
+            int partial_batch_count = 0;
+            while (poll_table_loader(table)) {
+                int row_count = loaded_row_count(table);
+                if (row_count > seen_count && row_count < 1000000) {
+                    partial_batch_count += 0 != row_count % TABLE_LOADER_BATCH_SIZE;
+                    seen_count = row_count;
+                    ++grow_count;
+                }
+            }
+            expect_int_eq(grow_count > 1, 1);
+            expect_int_eq(partial_batch_count, 0);
+            expect_ptr_eq(table->loader, NULL);
+            expect_int_eq(table->row_count, 1000000);
+            Table_Column *column = (Table_Column *)vec_seek(table->column_vec, 1);
+            expect_str_eq(((Table_Cell *)vec_seek(column->cell_vec, 999999))->str_data, "row 1000000");
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        it("stops early when cancelled, keeping the rows loaded so far") {
+            new_table_with_console_query_using_sqlite(&table, sql, 0, err_buf, sizeof(err_buf));
+            while (poll_table_loader(table) && loaded_row_count(table) < TABLE_LOADER_BATCH_SIZE);
+            cancel_table_loader(table);
+            expect_ptr_eq(table->loader, NULL);
+            expect_int_eq(table->row_count >= TABLE_LOADER_BATCH_SIZE, 1);
+            expect_int_eq(table->row_count < 1000000, 1);
+            Table_Column *column = (Table_Column *)vec_seek(table->column_vec, 0);
+            expect_int_eq(column->cell_count, table->row_count);
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        it("is cancelled with Ctrl-C, and the table is never reused") {
+            new_table_with_console_query_using_sqlite(&table, sql, 0, err_buf, sizeof(err_buf));
+            char message[64] = "";
+            char expected[64];
+            cancel_table_loader_for_user(table, message, sizeof(message));
+            expect_ptr_eq(table->loader, NULL);
+            expect_ptr_eq((void *)table->cache_key, NULL);
+            expect_int_eq(table->row_count < 1000000, 1);
+            snprintf(expected, sizeof(expected), "Cancelled after %d rows.", table->row_count);
+            expect_str_eq(message, expected);
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("trim_table_pool") {
+        Table_Pool pool;
+        Table *fruit = NULL;
+        Table *veg = NULL;
+        Table *nut = NULL;
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table fruit (id integer primary key, name text);"
+                "create table veg (id integer primary key, name text);"
+                "create table nut (id integer primary key, name text);"
+                "insert into fruit (name) values ('apple'), ('pear');"
+                "insert into veg (name) values ('leek');"
+                "insert into nut (name) values ('pecan');",
+                NULL, NULL, NULL);
+
+        it("releases the least recently used idle tables to stay within budget") {
+            new_table_with_data_using_sqlite(&fruit, "fruit");
+            new_table_with_data_using_sqlite(&veg, "veg");
+            new_table_with_data_using_sqlite(&nut, "nut");
+            unref_table_from_table_pool(&pool, fruit);
+            unref_table_from_table_pool(&pool, veg);
+            touch_table_in_table_pool(&pool, fruit);
+
+            Memory_Stats stats = memory_stats_from_table_pool(&pool);
+            pool.max_bytes = memory_in_use(&stats) - 1;
+            expect_int_eq(table_pool_is_over_budget(&pool), 1);
+            trim_table_pool(&pool);
+            expect_int_eq(table_pool_is_over_budget(&pool), 0);
+            expect_ptr_eq(veg->data_mem, NULL);
+            expect_int_eq(NULL != fruit->data_mem, 1);
+        } tested;
+
+        it("never releases a table that is referenced") {
+            pool.max_bytes = 1;
+            trim_table_pool(&pool);
+            expect_int_eq(pool.table_count, 1);
+            expect_int_eq(NULL != nut->data_mem, 1);
+            expect_int_eq(table_pool_is_over_budget(&pool), 1);
+            unref_table_from_table_pool(&pool, nut);
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("column dictionary") {
+        Table_Pool pool;
+        Table *table = NULL;
+        Table *wide = NULL;
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table ticket (id integer primary key, status text);"
+                "insert into ticket (status) values ('open'), ('closed'), ('open'), (null), (null);"
+                "create table serial (id integer primary key, code text);"
+                "with recursive n(i) as (select 1 union all select i + 1 from n where i < 2000)"
+                "  insert into serial (code) select 'sn' || i from n;",
+                NULL, NULL, NULL);
+        new_table_with_data_using_sqlite(&table, "ticket");
+        Table_Column *status_column = column_by_name_from_table(table, "status");
+        Table_Cell *open1 = (Table_Cell *)vec_seek(status_column->cell_vec, 0);
+        Table_Cell *closed = (Table_Cell *)vec_seek(status_column->cell_vec, 1);
+        Table_Cell *open2 = (Table_Cell *)vec_seek(status_column->cell_vec, 2);
+
+        it("stores each value of a column once") {
+            expect_ptr_eq(open1->str_data, open2->str_data);
+            expect_int_eq(open1->dict_code, open2->dict_code);
+            expect_int_eq(open1->dict_code != closed->dict_code, 1);
+            expect_int_eq(status_column->dictionary.entry_count, 2);
+            expect_str_eq(str_from_table_cell(status_column, open2), "open");
+        } tested;
+
+        it("shares one label among every NULL") {
+            Table_Cell *null1 = (Table_Cell *)vec_seek(status_column->cell_vec, 3);
+            Table_Cell *null2 = (Table_Cell *)vec_seek(status_column->cell_vec, 4);
+            expect_ptr_eq(null1->str_data, null2->str_data);
+            expect_str_eq(null1->str_data, "NULL");
+            expect_int_eq(null1->dict_code, 0);
+        } tested;
+
+        it("compares the cells of a column by their codes") {
+            expect_int_eq(table_cells_are_equal(status_column, open1, status_column, open2), 1);
+            expect_int_eq(table_cells_are_equal(status_column, open1, status_column, closed), 0);
+        } tested;
+
+        it("copies the text of each cell once values rarely repeat") {
+            new_table_with_data_using_sqlite(&wide, "serial");
+            Table_Column *code_column = column_by_name_from_table(wide, "code");
+            Table_Cell *last = (Table_Cell *)vec_seek(code_column->cell_vec, 1999);
+            expect_int_eq(code_column->dictionary.is_disabled, 1);
+            expect_ptr_eq(code_column->dictionary.entry_arr, NULL);
+            expect_int_eq(last->dict_code, 0);
+            expect_str_eq(str_from_table_cell(code_column, last), "sn2000");
+            unref_table_from_table_pool(&pool, wide);
+        } tested;
+
+        it("is cleared with the rows") {
+            clear_table_rows(table);
+            expect_int_eq(status_column->dictionary.entry_count, 0);
+            expect_ptr_eq(status_column->dictionary.slot_arr, NULL);
+        } tested;
+
+        unref_table_from_table_pool(&pool, table);
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("start_table_scan_using_sqlite") {
+        Table_Pool pool;
+        Table *table = NULL;
+        global_app_state.scan_worker_count = 4;
+        setup_pool_db(&pool, "/tmp/sqlite-view-scan-test.db");
+        sqlite3_exec(global_app_state.db,
+                "create table reading (id integer primary key, sensor text, value int);"
+                "with recursive n(i) as (select 1 union all select i + 1 from n where i < 20000)"
+                "  insert into reading (sensor, value) select 's' || (i % 3), i from n;"
+                // Each of the 4 segments holds 2000 rows.  The second meets
+                // the values in another order.  The last holds unique
+                // values, so disables its dictionary, then 'open' again.
+                "create table ticket (id integer primary key, status text);"
+                "with recursive n(i) as (select 1 union all select i + 1 from n where i < 8000)"
+                "  insert into ticket (status) select case"
+                "    when i = 8000 then 'open'"
+                "    when i > 6000 then 'u' || i"
+                "    when i > 2000 and i <= 4000 then"
+                "      case i % 3 when 0 then 'pending' when 1 then 'closed' else 'open' end"
+                "    else case i % 3 when 1 then 'open' when 2 then 'closed' else 'pending' end"
+                "  end from n;",
+                NULL, NULL, NULL);
+
+        it("publishes the rows of each segment, in the order and number of a serial load") {
+            Table *serial_table = NULL;
+            char err_buf[255] = "";
+            int partial_segment_count = 0;
+            new_table_with_data_using_sqlite(&table, "reading");
+            // Each of the 4 segments holds 5000 rows.
+            while (poll_table_loader(table)) {
+                partial_segment_count += 0 != loaded_row_count(table) % 5000;
+            }
+            new_table_with_console_query_using_sqlite(
+                    &serial_table, "select * from reading", 0, err_buf, sizeof(err_buf));
+            while (poll_table_loader(serial_table));
+
+            expect_int_eq(partial_segment_count, 0);
+            expect_int_eq(table->row_count, 20000);
+            expect_int_eq(serial_table->row_count, table->row_count);
+            int mismatch_count = 0;
+            loop (col_idx, table->col_count) {
+                Table_Column *column = vec_seek(table->column_vec, col_idx);
+                Table_Column *serial_column = vec_seek(serial_table->column_vec, col_idx);
+                loop (row_idx, table->row_count) {
+                    mismatch_count += !table_cells_are_equal(
+                            column, vec_seek(column->cell_vec, row_idx),
+                            serial_column, vec_seek(serial_column->cell_vec, row_idx));
+                }
+            }
+            expect_int_eq(mismatch_count, 0);
+            unref_table_from_table_pool(&pool, serial_table);
+            // Scan the table again in the tests below.
+            table->cache_key = NULL;
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        it("gives the cells of every segment the codes of the table's dictionaries") {
+            new_table_with_data_using_sqlite(&table, "ticket");
+            while (poll_table_loader(table));
+            Table_Column *status_column = column_by_name_from_table(table, "status");
+            Table_Cell *open1 = (Table_Cell *)vec_seek(status_column->cell_vec, 0);
+            Table_Cell *pending1 = (Table_Cell *)vec_seek(status_column->cell_vec, 2);
+            Table_Cell *pending2 = (Table_Cell *)vec_seek(status_column->cell_vec, 2000);
+            Table_Cell *open2 = (Table_Cell *)vec_seek(status_column->cell_vec, 2002);
+            expect_int_eq(table->row_count, 8000);
+            expect_int_eq(pending1->dict_code != 0, 1);
+            expect_int_eq(pending2->dict_code, pending1->dict_code);
+            expect_int_eq(open2->dict_code, open1->dict_code);
+            expect_int_eq(table_cells_are_equal(status_column, open1, status_column, open2), 1);
+            expect_int_eq(table_cells_are_equal(status_column, open1, status_column, pending2), 0);
+        } tested;
+
+        it("stops coding the column at a segment that disables its dictionary") {
+            Table_Column *status_column = column_by_name_from_table(table, "status");
+            Table_Cell *open1 = (Table_Cell *)vec_seek(status_column->cell_vec, 0);
+            Table_Cell *open3 = (Table_Cell *)vec_seek(status_column->cell_vec, 4002);
+            Table_Cell *open4 = (Table_Cell *)vec_seek(status_column->cell_vec, 7999);
+            Table_Cell *unique = (Table_Cell *)vec_seek(status_column->cell_vec, 6000);
+            expect_int_eq(status_column->dictionary.is_disabled, 1);
+            expect_int_eq(open3->dict_code, open1->dict_code);
+            expect_int_eq(unique->dict_code, 0);
+            expect_int_eq(open4->dict_code, 0);
+            expect_str_eq(str_from_table_cell(status_column, unique), "u6001");
+            expect_str_eq(str_from_table_cell(status_column, open4), "open");
+            expect_int_eq(table_cells_are_equal(status_column, open1, status_column, open3), 1);
+            expect_int_eq(table_cells_are_equal(status_column, open1, status_column, open4), 1);
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        it("keeps the rows before the first gap once cancelled, but not the table") {
+            char message[64] = "";
+            new_table_with_data_using_sqlite(&table, "reading");
+            cancel_table_loader_for_user(table, message, sizeof(message));
+            Table_Column *value_column = column_by_name_from_table(table, "value");
+            expect_ptr_eq(table->loader, NULL);
+            expect_ptr_eq((void *)table->cache_key, NULL);
+            expect_int_eq(table->row_count < 20000, 1);
+            expect_int_eq(value_column->cell_count, table->row_count);
+            if (table->row_count) {
+                Table_Cell *last = (Table_Cell *)vec_seek(value_column->cell_vec, table->row_count - 1);
+                expect_int_eq(last->data_as_int, table->row_count);
+            }
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        it("pages out the columns of a spilling pool as the segments are stitched") {
+            // Free pages were taken before the spill file, so are not backed by it.
+            drain_page_pool(&pool.page_pool);
+            expect_int_eq(open_page_pool_spill_file(&pool.page_pool, "/tmp"), 0);
+            // As enforce_memory_budget would, once over budget.
+            pool.max_bytes = 1;
+            pool.is_paging_out = 1;
+            new_table_with_data_using_sqlite(&table, "reading");
+            while (poll_table_loader(table));
+            Table_Column *value_column = column_by_name_from_table(table, "value");
+            Table_Cell *last = (Table_Cell *)vec_seek(value_column->cell_vec, 19999);
+            expect_int_eq(table->row_count, 20000);
+            expect_int_eq(value_column->cell_vec->spilled_bytes > 20000 * sizeof(Table_Cell) / 2, 1);
+            expect_int_eq(last->data_as_int, 20000);
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        global_app_state.scan_worker_count = 0;
+        teardown_pool_db(&pool);
+    } tested;
+}
+
+{
+    describe("populate_table_using_sqlite") {
+        Table_Pool pool;
+        Table *table = NULL;
+        char err_buf[256];
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table event (id integer primary key, note text);"
+                "with recursive n(i) as (select 1 union all select i + 1 from n where i < 5000)"
+                "  insert into event (note) select 'note ' || i from n;",
+                NULL, NULL, NULL);
+
+        it("stops at the end of a batch once the pool is over budget") {
+            pool.max_bytes = 1;
+            new_table_with_console_query_using_sqlite(
+                    &table, "select * from event", 0, err_buf, sizeof(err_buf));
+            expect_int_eq(table->row_count, TABLE_LOADER_BATCH_SIZE);
+            expect_int_eq(pool.is_over_budget, 0);
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        it("loads every row within budget") {
+            pool.max_bytes = 0;
+            new_table_with_console_query_using_sqlite(
+                    &table, "select * from event", 0, err_buf, sizeof(err_buf));
+            expect_int_eq(table->row_count, 5000);
+            unref_table_from_table_pool(&pool, table);
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
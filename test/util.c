@@ -0,0 +1,90 @@
+{
+    describe("format_int64") {
+        char buf[TEXT_LEN_FOR_LARGEST_INT + 1];
+
+        it("formats zero, positive and negative numbers") {
+            expect_int_eq(format_int64(buf, 0), 1);
+            expect_str_eq(buf, "0");
+            format_int64(buf, 1234567);
+            expect_str_eq(buf, "1234567");
+            format_int64(buf, -42);
+            expect_str_eq(buf, "-42");
+        } tested;
+
+        it("formats the full range of 64 bit integers") {
+            expect_int_eq(format_int64(buf, INT64_MIN), TEXT_LEN_FOR_LARGEST_INT);
+            expect_str_eq(buf, "-9223372036854775808");
+            format_int64(buf, INT64_MAX);
+            expect_str_eq(buf, "9223372036854775807");
+        } tested;
+    } tested;
+
+    describe("format_double") {
+        char buf[TEXT_LEN_FOR_LARGEST_FLOAT + 1];
+
+        it("formats floats the way sqlite displays them") {
+            format_double(buf, 0.5);
+            expect_str_eq(buf, "0.5");
+            format_double(buf, 3);
+            expect_str_eq(buf, "3.0");
+            format_double(buf, -1e100);
+            expect_str_eq(buf, "-1e+100");
+        } tested;
+
+        it("fits the widest float in FLOAT_DISPLAY_WIDTH") {
+            expect_int_eq(format_double(buf, -1.23456789012345e-300), FLOAT_DISPLAY_WIDTH);
+        } tested;
+    } tested;
+
+    describe("parse_int64") {
+        int64_t value = 0;
+
+        it("reads integers written by format_int64") {
+            expect_int_eq(parse_int64("-42", &value), 1);
+            expect_int_eq(value == -42, 1);
+            expect_int_eq(parse_int64("9223372036854775807", &value), 1);
+            expect_int_eq(value == INT64_MAX, 1);
+        } tested;
+
+        it("rejects text that is not written the same way") {
+            expect_int_eq(parse_int64("042", &value), 0);
+            expect_int_eq(parse_int64(" 42", &value), 0);
+            expect_int_eq(parse_int64("42x", &value), 0);
+            expect_int_eq(parse_int64("", &value), 0);
+            expect_int_eq(parse_int64("9223372036854775808", &value), 0);
+        } tested;
+    } tested;
+
+    describe("utf8_display_width") {
+        size_t fit_size = 0;
+        setlocale(LC_ALL, "C.UTF-8");
+
+        it("counts a column for each ASCII character") {
+            expect_int_eq(utf8_display_width("Hello, world!", 13, 40, &fit_size), 13);
+            expect_int_eq(fit_size, 13);
+            expect_int_eq(utf8_display_width("Hello, world!", 13, 5, &fit_size), 13);
+            expect_int_eq(fit_size, 5);
+        } tested;
+
+        it("counts characters rather than bytes") {
+            expect_int_eq(utf8_display_width("Gr\xc3\xbc\xc3\x9f dich", 11, 40, &fit_size), 9);
+            expect_int_eq(fit_size, 11);
+            expect_int_eq(utf8_display_width("Gr\xc3\xbc\xc3\x9f dich", 11, 3, &fit_size), 9);
+            expect_int_eq(fit_size, 4);
+        } tested;
+
+        it("counts two columns for wide characters, and never splits one") {
+            // "日本語" is three characters of three bytes, two columns each.
+            const char *text = "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e";
+            expect_int_eq(utf8_display_width(text, 9, 40, &fit_size), 6);
+            expect_int_eq(fit_size, 9);
+            expect_int_eq(utf8_display_width(text, 9, 5, &fit_size), 6);
+            expect_int_eq(fit_size, 6);
+        } tested;
+
+        it("counts a column for each invalid byte") {
+            expect_int_eq(utf8_display_width("a\xff\xc3", 3, 40, &fit_size), 3);
+            expect_int_eq(fit_size, 3);
+        } tested;
+    } tested;
+}
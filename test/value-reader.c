@@ -0,0 +1,105 @@
+{
+    describe("value reader") {
+        Table_Pool pool;
+        Table *table = NULL;
+        Value_Reader reader;
+        char line[VALUE_READER_LINE_LEN];
+        setup_pool_db(&pool, ":memory:");
+        sqlite3_exec(global_app_state.db,
+                "create table doc (id integer primary key, body text, data blob);"
+                "insert into doc values"
+                "  (1, replace(hex(zeroblob(1500)), '0', 'x'),"
+                "      cast(replace(hex(zeroblob(2500)), '00', 'ab') as blob)),"
+                "  (2, 'one' || char(10) || 'two', x'00ff');",
+                NULL, NULL, NULL);
+        new_table_with_data_using_sqlite(&table, "doc");
+        Table_Column *body_column = column_by_name_from_table(table, "body");
+        Table_Column *data_column = column_by_name_from_table(table, "data");
+        Table_Cell *large_body = (Table_Cell *)vec_seek(body_column->cell_vec, 0);
+        Table_Cell *large_data = (Table_Cell *)vec_seek(data_column->cell_vec, 0);
+        Table_Cell *small_body = (Table_Cell *)vec_seek(body_column->cell_vec, 1);
+        Table_Cell *small_data = (Table_Cell *)vec_seek(data_column->cell_vec, 1);
+
+        it("keeps only a preview of a large value") {
+            expect_int_eq(large_body->is_partial, 1);
+            expect_int_eq(large_body->row_key, 1);
+            expect_int_eq(large_body->raw_size, 3000);
+            expect_int_eq(large_body->str_size, CELL_PREVIEW_SIZE);
+            expect_int_eq(large_data->is_partial, 1);
+            expect_int_eq(large_data->raw_size, 5000);
+            expect_str_eq(large_data->str_data, "BLOB");
+        } tested;
+
+        it("copies a small value in full") {
+            expect_int_eq(small_body->is_partial, 0);
+            expect_int_eq(small_data->is_partial, 0);
+            expect_int_eq(small_data->raw_size, 2);
+        } tested;
+
+        it("selects a preview and the length of each value, not the value") {
+            char preview_sql[64];
+            snprintf(preview_sql, sizeof(preview_sql), "substr(\"body\", 1, %d)", CELL_PREVIEW_SIZE);
+            expect_int_eq(NULL != strstr(table->sql, preview_sql), 1);
+            expect_int_eq(NULL != strstr(table->sql, "length(\"data\")"), 1);
+        } tested;
+
+        it("counts the length of text in characters, and keeps them whole") {
+            Table *odd_table = NULL;
+            sqlite3_exec(global_app_state.db,
+                    "create table odd (\"order\" text, \"say \"\"hi\"\"\" text);"
+                    "insert into odd values (replace(hex(zeroblob(1025)), '00', 'é'), 'hi'),"
+                    "                       (replace(hex(zeroblob(1000)), '00', 'é'), 'hi');",
+                    NULL, NULL, NULL);
+            new_table_with_data_using_sqlite(&odd_table, "odd");
+            Table_Column *order_column = column_by_name_from_table(odd_table, "order");
+            Table_Cell *long_text = (Table_Cell *)vec_seek(order_column->cell_vec, 0);
+            Table_Cell *short_text = (Table_Cell *)vec_seek(order_column->cell_vec, 1);
+            expect_int_eq(NULL != odd_table->window, 1);
+            expect_int_eq(long_text->is_partial, 1);
+            expect_int_eq(long_text->raw_size, 1025);
+            expect_int_eq(long_text->str_size, CELL_PREVIEW_SIZE);
+            expect_int_eq(short_text->is_partial, 0);
+            expect_int_eq(short_text->str_size, 2000);
+            unref_table_from_table_pool(&pool, odd_table);
+        } tested;
+
+        it("reads a large text from the database, wrapped at the width") {
+            expect_int_eq(open_value_reader_using_sqlite(&reader, global_app_state.db, table, body_column, large_body), 0);
+            reader.width = 100;
+            expect_int_eq(reader.size, 3000);
+            expect_int_eq(read_value_line(&reader, 29, line), 1);
+            expect_int_eq(strlen(line), 100);
+            expect_int_eq(read_value_line(&reader, 30, line), 0);
+            expect_int_eq(reader.err, 0);
+            close_value_reader(&reader);
+        } tested;
+
+        it("reads a large BLOB from the database as a hex dump") {
+            expect_int_eq(open_value_reader_using_sqlite(&reader, global_app_state.db, table, data_column, large_data), 0);
+            expect_int_eq(read_value_line(&reader, 0, line), 1);
+            expect_str_eq(line, "00000000 61 62 61 62 61 62 61 62 61 62 61 62 61 62 61 62  abababababababab");
+            expect_int_eq(read_value_line(&reader, 312, line), 1);
+            expect_str_eq(line, "00001380 61 62 61 62 61 62 61 62                          abababab");
+            expect_int_eq(read_value_line(&reader, 313, line), 0);
+            expect_int_eq(reader.err, 0);
+            close_value_reader(&reader);
+        } tested;
+
+        it("breaks text at newlines") {
+            open_value_reader_using_sqlite(&reader, global_app_state.db, table, body_column, small_body);
+            expect_int_eq(read_value_line(&reader, 0, line), 1);
+            expect_str_eq(line, "one");
+            expect_int_eq(read_value_line(&reader, 1, line), 1);
+            expect_str_eq(line, "two");
+            expect_int_eq(read_value_line(&reader, 2, line), 0);
+            close_value_reader(&reader);
+        } tested;
+
+        it("fails if the row is gone") {
+            sqlite3_exec(global_app_state.db, "delete from doc where id = 1;", NULL, NULL, NULL);
+            expect_int_eq(0 != open_value_reader_using_sqlite(&reader, global_app_state.db, table, body_column, large_body), 1);
+        } tested;
+
+        teardown_pool_db(&pool);
+    } tested;
+}
@@ -39,4 +39,151 @@
         delete_vector(vec);
         delete_vector_iter(veci);
     } tested;
+
+    describe("vec_seek on large vectors") {
+        const int el_count = 1000000;
+
+        it("finds every element of a million element vector") {
+            Vector *vec = new_vector(sizeof(int), 200);
+            int mismatches = 0;
+            loop (idx, el_count) {
+                vec_push(vec, &idx);
+            }
+            loop (idx, el_count) {
+                if (*(int *)vec_seek(vec, idx) != idx) ++mismatches;
+            }
+            expect_int_eq(mismatches, 0);
+            expect_int_eq(vec->page_count, el_count / 200 + 1);
+            delete_vector(vec);
+        } tested;
+
+        it("finds every element of a million element geometric vector") {
+            Vector *vec = new_geometric_vector(sizeof(int), 200);
+            int mismatches = 0;
+            loop (idx, el_count) {
+                vec_push(vec, &idx);
+            }
+            loop (idx, el_count) {
+                if (*(int *)vec_seek(vec, idx) != idx) ++mismatches;
+            }
+            expect_int_eq(mismatches, 0);
+            expect_int_eq(vec->page_count, 13);
+            delete_vector(vec);
+        } tested;
+
+        it("iterates a million element geometric vector in order") {
+            Vector *vec = new_geometric_vector(sizeof(int), 3);
+            int mismatches = 0;
+            int expected = 0;
+            int *el = NULL;
+            loop (idx, el_count) {
+                vec_push(vec, &idx);
+            }
+            Vector_Iter *veci = new_vector_iter(vec);
+            vec_loop (veci, int, el) {
+                if (*el != expected) ++mismatches;
+                ++expected;
+            } delete_vector_iter(veci);
+            expect_int_eq(mismatches, 0);
+            expect_int_eq(expected, el_count);
+            delete_vector(vec);
+        } tested;
+    } tested;
+
+    describe("vec_pop") {
+        it("returns elements in reverse order across page boundaries") {
+            Vector *vec = new_geometric_vector(sizeof(int), 3);
+            int mismatches = 0;
+            loop (idx, 1000) {
+                vec_push(vec, &idx);
+            }
+            for (int idx = 999; idx >= 0; --idx) {
+                if (*(int *)vec_pop(vec) != idx) ++mismatches;
+            }
+            expect_int_eq(mismatches, 0);
+            expect_ptr_eq(NULL, vec_pop(vec));
+            delete_vector(vec);
+        } tested;
+
+        it("allows the vector to be refilled after popping") {
+            Vector *vec = new_vector(sizeof(int), 3);
+            loop (idx, 10) {
+                vec_push(vec, &idx);
+            }
+            loop (idx, 4) {
+                vec_pop(vec);
+            }
+            loop_from (idx, 6, 10) {
+                vec_push(vec, &idx);
+            }
+            loop (idx, 10) {
+                expect_int_eq(*(int *)vec_seek(vec, idx), idx);
+            }
+            delete_vector(vec);
+        } tested;
+    } tested;
+
+    describe("vec_clear") {
+        it("empties the vector and reuses its pages") {
+            Vector *vec = new_vector(sizeof(int), 3);
+            loop (idx, 10) {
+                vec_push(vec, &idx);
+            }
+            int page_count = vec->page_count;
+            vec_clear(vec);
+            expect_int_eq(vec->len, 0);
+
+            loop (idx, 10) {
+                vec_push(vec, &idx);
+            }
+            expect_int_eq(vec->page_count, page_count);
+            expect_int_eq(*(int *)vec_seek(vec, 9), 9);
+            delete_vector(vec);
+        } tested;
+    } tested;
+
+    describe("vec_append") {
+        it("copies every element of one vector to the end of another") {
+            Vector *vec = new_geometric_vector(sizeof(int), 3);
+            Vector *src = new_geometric_vector(sizeof(int), 5);
+            loop (idx, 10) {
+                vec_push(vec, &idx);
+            }
+            loop_from (idx, 10, 1000) {
+                vec_push(src, &idx);
+            }
+            vec_append(vec, src);
+            expect_int_eq(vec->len, 1000);
+
+            int mismatches = 0;
+            loop (idx, 1000) {
+                if (*(int *)vec_seek(vec, idx) != idx) ++mismatches;
+            }
+            expect_int_eq(mismatches, 0);
+
+            int next = 1000;
+            vec_push(vec, &next);
+            expect_int_eq(*(int *)vec_seek(vec, 1000), 1000);
+
+            delete_vector(vec);
+            delete_vector(src);
+        } tested;
+    } tested;
+
+    describe("vector counters") {
+        it("count the bytes held in pages") {
+            Vector *vec = new_geometric_vector(sizeof(int), 4);
+            loop (idx, 10) {
+                vec_push(vec, &idx);
+            }
+            // Pages of 4 and 8 ints.
+            expect_int_eq(vec->page_count, 2);
+            expect_int_eq(vec->reserved_bytes, 12 * sizeof(int));
+
+            vec_clear(vec);
+            expect_int_eq(vec->reserved_bytes, 12 * sizeof(int));
+            expect_int_eq(vec->peak_bytes, 12 * sizeof(int));
+            delete_vector(vec);
+        } tested;
+    } tested;
 }